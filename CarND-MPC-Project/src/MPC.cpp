@@ -2,88 +2,119 @@
 #include <cppad/cppad.hpp>
 #include <cppad/ipopt/solve.hpp>
 #include "Eigen-3.3/Eigen/Core"
+#include "mpc_model.h"
 
 using CppAD::AD;
 
-// Set the timestep length and duration
+// Set the timestep length and duration (the default, see set_time_step)
 size_t N = 15;
 double dt = 0.15;
 
-// Start-indices for the various values
-size_t x_start     = 0;                    // N values
-size_t y_start     = x_start + N;	   // N values
-size_t psi_start   = y_start + N;	   // N values
-size_t v_start     = psi_start + N;	   // N values
-size_t cte_start   = v_start + N;	   // N values
-size_t epsi_start  = cte_start + N;	   // N values
-size_t delta_start = epsi_start + N;       // N-1 values
-size_t a_start     = delta_start + N - 1;  // N-1 values
-
-// This is the length from front to CoG that has a similar radius.
-const double Lf = 2.67;
-
-// Both the reference cross track and orientation errors are 0.
-// The reference velocity is set between 40 - 100 mph.
-double ref_cte  = 0;
-double ref_epsi = 0;
-double ref_v    = 80;
-
-class FG_eval {
+typedef CPPAD_TESTVECTOR(double) Dvector;
+typedef CPPAD_TESTVECTOR(AD<double>) ADvector;
+
+// Scratch vectors of FG_eval
+struct Scratch {
+  ADvector unscaled;
+  ADvector stage;
+  ADvector next;
+};
+
+// Options of the solver, and the CPU time limit they were made for
+struct SolverOptions {
+  SolverOptions() : cpu_time(0) {}
+
+  double cpu_time;
+  std::string text;
+};
+
+// Options are kept for this many CPU time limits: those of a controller's
+// own solves and of its speculative ones
+const int kOptionSets = 2;
+
+struct MPCWorkspace::Buffers {
+  Buffers() : n_vars(0), next_options(0) {}
+
+  // The problem as handed to the solver: the starting point, the bounds of
+  // the variables and those of the constraints, and the solver's result
+  Dvector vars;
+  Dvector vars_lowerbound;
+  Dvector vars_upperbound;
+  Dvector constraints_lowerbound;
+  Dvector constraints_upperbound;
+  CppAD::ipopt::solve_result<Dvector> result;
+  // All variables of the last solution in the units of the model, and
+  // their number
+  vector<double> solution;
+  size_t n_vars;
+  Scratch scratch;
+  // The stage dynamics checkpoint, kept while the integrator and step
+  // stay the same
+  std::unique_ptr<StageDynamics> dynamics;
+  // Options of the solver for the last kOptionSets CPU time limits, and
+  // the set to make anew next
+  SolverOptions options[kOptionSets];
+  int next_options;
+};
+
+MPCWorkspace::MPCWorkspace()
+    : buffers_(new Buffers), warm_start_(false) {}
+MPCWorkspace::~MPCWorkspace() {}
+
+class FG_eval : public Layout {
  public:
+  typedef ::ADvector ADvector;
+
   // Fitted polynomial coefficients
-  Eigen::VectorXd coeffs;
-  FG_eval(Eigen::VectorXd coeffs) { this->coeffs = coeffs; }
+  const MPCCoeffs& coeffs;
+  // Length of a step (seconds) and how the model is integrated over it
+  double dt;
+  Integrator integrator;
+  // Terminal cost, if any
+  const TerminalCost* terminal;
+  // The dynamics of a stage as a checkpoint, if they go on the tape as one
+  StageDynamics* dynamics;
+  // Scaling of the variables, constraints and cost the solver sees, if any
+  const Scaling* scaling;
+  // Where to work
+  Scratch& scratch;
+  FG_eval(const MPCCoeffs& coeffs, size_t horizon, double dt,
+          Integrator integrator, const TerminalCost* terminal,
+          StageDynamics* dynamics, Scratch& scratch)
+      : Layout(horizon),
+        coeffs(coeffs),
+        dt(dt),
+        integrator(integrator),
+        terminal(terminal),
+        dynamics(dynamics),
+        scaling(nullptr),
+        scratch(scratch) {}
 
-  typedef CPPAD_TESTVECTOR(AD<double>) ADvector;
   void operator()(ADvector& fg, const ADvector& vars) {
+    if (scaling == nullptr) {
+      Evaluate(fg, vars);
+      return;
+    }
+    ADvector& unscaled = scratch.unscaled;
+    unscaled.resize(vars.size());
+    for (size_t i = 0; i < vars.size(); i++) {
+      unscaled[i] = vars[i] * scaling->range(i);
+    }
+    Evaluate(fg, unscaled);
+    fg[0] /= scaling->cost;
+    for (size_t i = 1; i < fg.size(); i++) {
+      fg[i] /= scaling->range(i - 1);
+    }
+  }
+
+  // The cost and constraints in the units of the model
+  void Evaluate(ADvector& fg, const ADvector& vars) {
     // MPC Implementation (mainly repurposed from Quiz solution)
     // `fg` a vector of the cost constraints,
     // `vars` is a vector of variable values (state & actuators)
 
     // The cost is stored is the first element of `fg`.
-    // Any additions to the cost should be added to `fg[0]`.
-
-
-    // Weights for the cost function
-    const double w_cte    = 1000;
-    const double w_epsi   = 1000;
-    const double w_dv     = 1;
-    const double w_delta  = 100;
-    const double w_a      = 10;
-    const double w_ddelta = 10;
-    const double w_da     = 10;
-    
-    // Initialize
-    fg[0] = 0;
-
-    for (size_t t = 0; t < N; t++) {
-      // Minimize cross-track error
-      fg[0] += w_cte  * CppAD::pow(vars[cte_start + t], 2);
-
-      // Minimize error in direction
-      fg[0] += w_epsi * CppAD::pow(vars[epsi_start + t], 2);
-
-      // Minimize deviation from reference velocity
-      fg[0] += w_dv * CppAD::pow(vars[v_start + t] - ref_v, 2);
-    }
-
-    for (unsigned int t = 0; t < N - 1; t++) {
-      // Minimize use of steering
-      fg[0] += w_delta * CppAD::pow(vars[delta_start + t], 2);
-
-      // Minimize use of throttle
-      fg[0] += w_a * CppAD::pow(vars[a_start + t], 2);
-    }
-
-    for (unsigned int t = 0; t < N - 2; t++) {
-      // Minimize sudden turns
-      fg[0] += w_ddelta * CppAD::pow(vars[delta_start + t + 1] -
-				     vars[delta_start + t], 2);
-
-      // Minimize sudden accelerations or braking
-      fg[0] += w_da * CppAD::pow(vars[a_start + t + 1] -
-				 vars[a_start + t], 2);
-    }
+    fg[0] = Cost<AD<double>>(*this, vars, terminal);
 
     // The state at time 0
     fg[x_start    + 1] = vars[x_start];
@@ -93,49 +124,38 @@ class FG_eval {
     fg[cte_start  + 1] = vars[cte_start];
     fg[epsi_start + 1] = vars[epsi_start];
 
-    // The rest of the constraints
+    // The rest of the constraints. The checkpoint takes the path after the
+    // variables of the stage.
+    ADvector& stage = scratch.stage;
+    ADvector& next = scratch.next;
+    stage.resize(kStageSize + kCoeffs);
+    next.resize(kStateSize);
+    for (int i = 0; i < kCoeffs; i++) {
+      stage[kStageSize + i] = coeffs[i];
+    }
     for (unsigned int t = 0; t < N-2; t++) {
-      // The state at time t.
-      AD<double> x0    = vars[x_start    + t];
-      AD<double> y0    = vars[y_start    + t];
-      AD<double> psi0  = vars[psi_start  + t];
-      AD<double> v0    = vars[v_start    + t];
-      AD<double> cte0  = vars[cte_start  + t];
-      AD<double> epsi0 = vars[epsi_start + t];
-
-
-      // The state at time t+1 .
-      AD<double> x1    = vars[x_start    + t + 1];
-      AD<double> y1    = vars[y_start    + t + 1];
-      AD<double> psi1  = vars[psi_start  + t + 1];
-      AD<double> v1    = vars[v_start    + t + 1];
-      AD<double> cte1  = vars[cte_start  + t + 1];
-      AD<double> epsi1 = vars[epsi_start + t + 1];
-
-      // Only consider the actuation at time t.
-      AD<double> delta0 = vars[delta_start + t];
-      AD<double> a0     = vars[a_start     + t];
-
-      // Apply polynomial equation for CTE
-      AD<double> f0 =             
-	coeffs[0] +		  
-	coeffs[1] * x0 +	  
-	coeffs[2] * x0 * x0 +     
-	coeffs[3] * x0 * x0 * x0;
-      
-      // Tangent for psi
-      AD<double> psides0 = CppAD::atan(                    
-				       1*coeffs[1] +       
-				       2*coeffs[2]*x0 +
-				       3*coeffs[3]*x0*x0);
+      // The state at time t and the actuation applied until t+1
+      stage[0] = vars[x_start     + t];
+      stage[1] = vars[y_start     + t];
+      stage[2] = vars[psi_start   + t];
+      stage[3] = vars[v_start     + t];
+      stage[4] = vars[cte_start   + t];
+      stage[5] = vars[epsi_start  + t];
+      stage[6] = vars[delta_start + t];
+      stage[7] = vars[a_start     + t];
 
       // Cost variables by application of predictive model from time t0 to t1
-      fg[x_start    + t + 2] = x1    - (x0 + v0 * CppAD::cos(psi0) * dt);
-      fg[y_start    + t + 2] = y1    - (y0 + v0 * CppAD::sin(psi0) * dt);
-      fg[psi_start  + t + 2] = psi1  - (psi0 + v0 * delta0 / Lf * dt);
-      fg[v_start    + t + 2] = v1    - (v0 + a0 * dt);
-      fg[cte_start  + t + 2] = cte1  - ((f0 - y0) + (v0 * CppAD::sin(epsi0) * dt));
-      fg[epsi_start + t + 2] = epsi1 - ((psi0 - psides0) + v0 * delta0 / Lf * dt);
+      if (dynamics != nullptr) {
+        (*dynamics)(stage, next);
+      } else {
+        Propagate(coeffs, integrator, dt, &stage[0], &next[0]);
+      }
+      fg[x_start    + t + 2] = vars[x_start    + t + 1] - next[0];
+      fg[y_start    + t + 2] = vars[y_start    + t + 1] - next[1];
+      fg[psi_start  + t + 2] = vars[psi_start  + t + 1] - next[2];
+      fg[v_start    + t + 2] = vars[v_start    + t + 1] - next[3];
+      fg[cte_start  + t + 2] = vars[cte_start  + t + 1] - next[4];
+      fg[epsi_start + t + 2] = vars[epsi_start + t + 1] - next[5];
     }
   }
 };
@@ -143,13 +163,50 @@ class FG_eval {
 //
 // MPC class definition implementation.
 //
-MPC::MPC() {}
+MPC::MPC()
+    : max_cpu_time_(0.5),
+      terminal_(kNoTerminal),
+      integrator_(kEuler),
+      time_step_(dt),
+      checkpoint_(false),
+      scaling_(false),
+      solver_hook_(nullptr) {}
 MPC::~MPC() {}
 
-vector<double> MPC::Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs) {
+bool MPC::Solve(const MPCState& state, const MPCCoeffs& coeffs,
+                MPCWorkspace* workspace, SolveResult* result,
+                size_t horizon) const {
+  if (horizon == 0) horizon = N;
+  MPCWorkspace::Buffers& buffers = *workspace->buffers_;
+
+  // The terminal cost depends on the fixed reference speed and the time
+  // step only, and takes a few microseconds to compute
+  const TerminalCost terminal_cost(time_step_);
+
+  // The stage checkpoint is recorded anew only for another model
+  if (checkpoint_ && (!buffers.dynamics ||
+                      buffers.dynamics->integrator() != integrator_ ||
+                      buffers.dynamics->dt() != time_step_)) {
+    buffers.dynamics.reset(new StageDynamics(integrator_, time_step_));
+  }
+
+  // object that computes objective and constraints
+  FG_eval fg_eval(coeffs, horizon, time_step_, integrator_,
+                  terminal_ != kNoTerminal ? &terminal_cost : nullptr,
+                  checkpoint_ ? buffers.dynamics.get() : nullptr,
+                  buffers.scratch);
+  const size_t N = fg_eval.N;
+  const size_t x_start = fg_eval.x_start;
+  const size_t y_start = fg_eval.y_start;
+  const size_t psi_start = fg_eval.psi_start;
+  const size_t v_start = fg_eval.v_start;
+  const size_t cte_start = fg_eval.cte_start;
+  const size_t epsi_start = fg_eval.epsi_start;
+  const size_t delta_start = fg_eval.delta_start;
+  const size_t a_start = fg_eval.a_start;
+
   bool ok = true;
   size_t i;
-  typedef CPPAD_TESTVECTOR(double) Dvector;
 
   double x    = state[0];
   double y    = state[1];
@@ -164,10 +221,17 @@ vector<double> MPC::Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs) {
 
   // Initial value of the independent variables.
   // SHOULD BE 0 besides initial state.
-  Dvector vars(n_vars);
+  Dvector& vars = buffers.vars;
+  vars.resize(n_vars);
   for (i = 0; i < n_vars; i++) {
     vars[i] = 0;
   }
+  if (workspace->warm_start_ && buffers.n_vars == n_vars) {
+    for (i = 0; i < n_vars; i++) {
+      vars[i] = buffers.solution[i];
+    }
+  }
+  workspace->warm_start_ = false;
 
   // Set the initial variable values
   vars[x_start   ] = x;
@@ -177,8 +241,10 @@ vector<double> MPC::Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs) {
   vars[cte_start ] = cte;
   vars[epsi_start] = epsi;
   
-  Dvector vars_lowerbound(n_vars);
-  Dvector vars_upperbound(n_vars);
+  Dvector& vars_lowerbound = buffers.vars_lowerbound;
+  Dvector& vars_upperbound = buffers.vars_upperbound;
+  vars_lowerbound.resize(n_vars);
+  vars_upperbound.resize(n_vars);
 
   // Set all non-actuators upper and lowerlimits
   // to the max negative and positive values.
@@ -199,11 +265,22 @@ vector<double> MPC::Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs) {
     vars_lowerbound[i] = -1.0;
     vars_upperbound[i] =  1.0;
   }
+
+  if (terminal_ == kTerminalSet) {
+    // The last state the model constrains ends up near the reference
+    const size_t T = N - 2;
+    vars_lowerbound[cte_start  + T] = -kTerminalCte;
+    vars_upperbound[cte_start  + T] =  kTerminalCte;
+    vars_lowerbound[epsi_start + T] = -kTerminalEpsi;
+    vars_upperbound[epsi_start + T] =  kTerminalEpsi;
+  }
  
   // Lower and upper limits for the constraints
   // Should be 0 besides initial state.
-  Dvector constraints_lowerbound(n_constraints);
-  Dvector constraints_upperbound(n_constraints);
+  Dvector& constraints_lowerbound = buffers.constraints_lowerbound;
+  Dvector& constraints_upperbound = buffers.constraints_upperbound;
+  constraints_lowerbound.resize(n_constraints);
+  constraints_upperbound.resize(n_constraints);
   for (i = 0; i < n_constraints; i++) {
     constraints_lowerbound[i] = 0;
     constraints_upperbound[i] = 0;
@@ -223,54 +300,95 @@ vector<double> MPC::Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs) {
   constraints_upperbound[v_start   ] = v;
   constraints_upperbound[cte_start ] = cte;
   constraints_upperbound[epsi_start] = epsi;
-  
-  // object that computes objective and constraints
-  FG_eval fg_eval(coeffs);
+
+  // The solver works on the scaled problem. Infinite bounds stay infinite.
+  const Scaling scaling(fg_eval);
+  if (scaling_) {
+    fg_eval.scaling = &scaling;
+    for (i = 0; i < n_vars; i++) {
+      const double range = scaling.range(i);
+      vars[i] /= range;
+      if (vars_lowerbound[i] > -1.0e19) vars_lowerbound[i] /= range;
+      if (vars_upperbound[i] <  1.0e19) vars_upperbound[i] /= range;
+    }
+    for (i = 0; i < n_constraints; i++) {
+      constraints_lowerbound[i] /= scaling.range(i);
+      constraints_upperbound[i] /= scaling.range(i);
+    }
+  }
 
   //
   // NOTE: You don't have to worry about these options
   //
-  // options for IPOPT solver
-  std::string options;
-  // Uncomment this if you'd like more print information
-  options += "Integer print_level  0\n";
-  // NOTE: Setting sparse to true allows the solver to take advantage
-  // of sparse routines, this makes the computation MUCH FASTER. If you
-  // can uncomment 1 of these and see if it makes a difference or not but
-  // if you uncomment both the computation time should go up in orders of
-  // magnitude.
-  options += "Sparse  true        forward\n";
-  options += "Sparse  true        reverse\n";
-  // NOTE: Currently the solver has a maximum time limit of 0.5 seconds.
-  // Change this as you see fit.
-  options += "Numeric max_cpu_time          0.5\n";
+  // options for IPOPT solver, made once per time limit
+  std::string* found = nullptr;
+  for (SolverOptions& o : buffers.options) {
+    if (!o.text.empty() && o.cpu_time == max_cpu_time_) found = &o.text;
+  }
+  if (found == nullptr) {
+    SolverOptions& made = buffers.options[buffers.next_options];
+    buffers.next_options = (buffers.next_options + 1) % kOptionSets;
+    std::string& options = made.text;
+    options.clear();
+    // Uncomment this if you'd like more print information
+    options += "Integer print_level  0\n";
+    // NOTE: Setting sparse to true allows the solver to take advantage
+    // of sparse routines, this makes the computation MUCH FASTER. If you
+    // can uncomment 1 of these and see if it makes a difference or not but
+    // if you uncomment both the computation time should go up in orders of
+    // magnitude.
+    options += "Sparse  true        forward\n";
+    options += "Sparse  true        reverse\n";
+    // NOTE: Currently the solver has a maximum time limit of 0.5 seconds
+    // by default (see set_max_cpu_time).
+    // Change this as you see fit.
+    options += "Numeric max_cpu_time          " +
+               std::to_string(max_cpu_time_) + "\n";
+    made.cpu_time = max_cpu_time_;
+    found = &options;
+  }
+  const std::string& options = *found;
 
   // place to return solution
-  CppAD::ipopt::solve_result<Dvector> solution;
+  CppAD::ipopt::solve_result<Dvector>& solution = buffers.result;
 
   // solve the problem
+  if (solver_hook_ != nullptr) solver_hook_(true);
   CppAD::ipopt::solve<Dvector, FG_eval>(
       options, vars, vars_lowerbound, vars_upperbound, constraints_lowerbound,
       constraints_upperbound, fg_eval, solution);
+  if (solver_hook_ != nullptr) solver_hook_(false);
 
   // Check some of the solution values
   ok &= solution.status == CppAD::ipopt::solve_result<Dvector>::success;
 
   // Cost
-  auto cost = solution.obj_value;
-  std::cout << "Cost " << cost << std::endl;
+  auto cost = scaling_ ? solution.obj_value * scaling.cost
+                       : solution.obj_value;
 
-  // TODO: Return the first actuator values. The variables can be accessed with
-  // `solution.x[i]`.
-  //
-  // {...} is shorthand for creating a vector, so auto x1 = {1.0,2.0}
-  // creates a 2 element double vector.
-  vector<double> result;
-  result.push_back(solution.x[delta_start]);
-  result.push_back(solution.x[a_start]);
-  for (size_t i = 0; i<N-1; ++i) {
-    result.push_back(solution.x[x_start + i]);
-    result.push_back(solution.x[y_start + i]);  
+  vector<double>& unscaled = buffers.solution;
+  unscaled.resize(n_vars);
+  for (i = 0; i < n_vars; i++) {
+    unscaled[i] = scaling_ ? solution.x[i] * scaling.range(i)
+                           : solution.x[i];
   }
-  return result;
+  buffers.n_vars = n_vars;
+
+  // The first actuator values, and views of the plan
+  result->ok = ok;
+  result->cost = cost;
+  result->steering = unscaled[delta_start];
+  result->throttle = unscaled[a_start];
+  result->n = int(N - 1);
+  result->x = &unscaled[x_start];
+  result->y = &unscaled[y_start];
+  result->psi = &unscaled[psi_start];
+  result->v = &unscaled[v_start];
+  result->cte = &unscaled[cte_start];
+  result->epsi = &unscaled[epsi_start];
+  result->planned_steering = &unscaled[delta_start];
+  result->planned_throttle = &unscaled[a_start];
+  return ok;
 }
+
+double MPC::time_step() const { return time_step_; }
@@ -1,20 +1,126 @@
 #ifndef MPC_H
 #define MPC_H
 
+#include <memory>
 #include <vector>
 #include "Eigen-3.3/Eigen/Core"
+#include "integrator.h"
 
 using namespace std;
 
+// State the MPC starts from: x, y, psi, v, cte and epsi.
+typedef Eigen::Matrix<double, 6, 1> MPCState;
+// Coefficients of the cubic reference path, lowest order first.
+typedef Eigen::Matrix<double, 4, 1> MPCCoeffs;
+
+// Every buffer a solve needs, owned by the caller and reused from one
+// solve to the next, so that solving again over a horizon no longer than
+// before, with one of the last two CPU time limits, allocates nothing
+// outside the solver itself. It also keeps the last solution, to warm
+// start from. One workspace serves one solve at a time.
+class MPCWorkspace {
+ public:
+  MPCWorkspace();
+  ~MPCWorkspace();
+
+  // Start the next solve from the last solution instead of from rest, if
+  // their horizons match.
+  void WarmStart() { warm_start_ = true; }
+
+ private:
+  friend class MPC;
+  struct Buffers;
+
+  std::unique_ptr<Buffers> buffers_;
+  bool warm_start_;
+};
+
+// Outcome of a solve. The plans are views into the solution kept by the
+// workspace, valid until its next solve.
+struct SolveResult {
+  // Whether the solver converged, and the cost of the solution
+  bool ok;
+  double cost;
+  // The first actuations: steering (radians, positive turning toward
+  // positive y) and throttle
+  double steering;
+  double throttle;
+  // The planned states, n of them: all but the last state of the horizon,
+  // which the model leaves unconstrained
+  int n;
+  const double* x;
+  const double* y;
+  const double* psi;
+  const double* v;
+  const double* cte;
+  const double* epsi;
+  // The planned actuations, n of them: one from each planned state
+  const double* planned_steering;
+  const double* planned_throttle;
+};
+
 class MPC {
  public:
+  // Terminal ingredients, which keep short horizons stable.
+  enum Terminal {
+    // None, the default
+    kNoTerminal,
+    // The last state is charged the cost-to-go of the LQR of the model
+    // linearized about driving straight at the reference speed
+    kTerminalCost,
+    // That, and the errors of the last state are kept within a small box
+    kTerminalSet,
+  };
+
   MPC();
 
   virtual ~MPC();
 
-  // Solve the model given an initial state and polynomial coefficients.
-  // Return the first actuatotions.
-  vector<double> Solve(Eigen::VectorXd state, Eigen::VectorXd coeffs);
+  // Solve the model given an initial state and polynomial coefficients in
+  // the workspace, over a horizon of the given number of steps (at least
+  // 3), or the default one for 0. Returns whether the solver converged.
+  bool Solve(const MPCState& state, const MPCCoeffs& coeffs,
+             MPCWorkspace* workspace, SolveResult* result,
+             size_t horizon = 0) const;
+
+  // Length of a step of the horizon (seconds).
+  double time_step() const;
+
+  // Give up on a solve after this much CPU time (seconds).
+  void set_max_cpu_time(double seconds) { max_cpu_time_ = seconds; }
+  double max_cpu_time() const { return max_cpu_time_; }
+
+  void set_terminal(Terminal terminal) { terminal_ = terminal; }
+
+  // How the model is integrated over a step, and the length of a step
+  // (seconds). Higher order integrators stay accurate over longer steps, so
+  // fewer of them cover the same lookahead.
+  void set_integrator(Integrator integrator) { integrator_ = integrator; }
+  void set_time_step(double seconds) { time_step_ = seconds; }
+
+  // Tape the dynamics of a stage once as a CppAD checkpoint function that
+  // every stage calls, rather than once per stage. Off by default.
+  void set_checkpoint(bool checkpoint) { checkpoint_ = checkpoint; }
+
+  // Hand the solver the problem scaled by the typical magnitudes of its
+  // variables, constraints and cost, rather than in the units of the
+  // model. Off by default.
+  void set_scaling(bool scaling) { scaling_ = scaling; }
+
+  // Instrumentation: called on the solving thread with true right before a
+  // solve hands the problem to CppAD and Ipopt, and with false once they
+  // return, so that their work can be told from the MPC's own.
+  typedef void (*SolverHook)(bool in_solver);
+  void set_solver_hook(SolverHook hook) { solver_hook_ = hook; }
+
+ private:
+  double max_cpu_time_;
+  Terminal terminal_;
+  Integrator integrator_;
+  double time_step_;
+  bool checkpoint_;
+  bool scaling_;
+  SolverHook solver_hook_;
 };
 
 #endif /* MPC_H */
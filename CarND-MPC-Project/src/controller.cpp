@@ -0,0 +1,196 @@
+#include "controller.h"
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "Eigen-3.3/Eigen/Core"
+#include "geometry.h"
+#include "mpc_model.h"
+#include "polyfit.h"
+
+// Report the path cache and speculation hit rates every so many telemetry
+// frames.
+const int kCacheReportInterval = 500;
+
+// Actuator delay of the simulator (seconds).
+const double kActuatorDelay = 0.1;
+
+// Weight of the newest frame in the moving average of the processing time,
+// and the most processing time compensated for (seconds).
+const double kProcessingWeight = 0.1;
+const double kMaxProcessing = 0.5;
+
+// The latency prediction integrates the model in steps of at most this
+// long (seconds).
+const double kPredictionStep = 0.02;
+
+// Weight of the newest interval in the moving average of the time between
+// frames. Longer intervals than kMaxFrameInterval (seconds) are pauses and
+// left out.
+const double kIntervalWeight = 0.1;
+const double kMaxFrameInterval = 1.0;
+
+// A frame is answered by the speculative solve if it is this close to the
+// expected one: position (m), heading (radians) and speed (mph).
+const double kSpeculationPosition = 0.3;
+const double kSpeculationHeading = 0.02;
+const double kSpeculationSpeed = 1.0;
+
+// Whether telemetry t is close enough to the expected frame e to be
+// answered like it, along the same waypoints.
+static bool CloseTo(const Telemetry& e, const Telemetry& t) {
+  if (t.n != e.n ||
+      !std::equal(t.ptsx, t.ptsx + t.n, e.ptsx) ||
+      !std::equal(t.ptsy, t.ptsy + t.n, e.ptsy)) {
+    return false;
+  }
+  const double heading = remainder(t.psi - e.psi, 2 * M_PI);
+  return hypot(t.x - e.x, t.y - e.y) <= kSpeculationPosition &&
+         fabs(heading) <= kSpeculationHeading &&
+         fabs(t.speed - e.speed) <= kSpeculationSpeed;
+}
+
+Controller::Controller()
+    : result_(), horizon_(0), actuator_delay_(kActuatorDelay),
+      processing_(0), frame_interval_(kActuatorDelay), steps_(0),
+      speculated_(false), speculative_horizon_(0), cost_(0),
+      speculative_cost_(0), speculations_(0), speculation_hits_(0) {}
+
+void Controller::RecordProcessing(double seconds) {
+  processing_ += kProcessingWeight * (seconds - processing_);
+  processing_ = std::min(kMaxProcessing, std::max(0.0, processing_));
+}
+
+void Controller::Step(const Telemetry& t, Actuation* out, int horizon,
+                      TrackedPlan* plan) {
+  const auto now = std::chrono::steady_clock::now();
+  if (steps_++ > 0) {
+    const double interval =
+        std::chrono::duration<double>(now - last_step_).count();
+    if (interval < kMaxFrameInterval) {
+      frame_interval_ += kIntervalWeight * (interval - frame_interval_);
+    }
+  }
+  last_step_ = now;
+  if (steps_ % kCacheReportInterval == 0) {
+    std::cout << "Speculative solves used " << speculation_hits_ << " of "
+              << speculations_ << std::endl;
+  }
+
+  if (speculated_ && horizon == speculative_horizon_ &&
+      CloseTo(speculative_t_, t)) {
+    // Solved already, and the MPC's plan is still the one for it
+    *out = speculative_out_;
+    cost_ = speculative_cost_;
+    speculation_hits_++;
+  } else {
+    if (speculated_) workspace_.WarmStart();
+    Solve(t, out, horizon);
+    cost_ = result_.cost;
+  }
+  speculated_ = false;
+
+  if (plan != nullptr) {
+    MakePlan(t, *out, result_.planned_throttle, result_.n, mpc_.time_step(),
+             plan);
+  }
+}
+
+void Controller::Speculate(const Telemetry& t, const Actuation& act,
+                           int horizon, double budget) {
+  // The car moved on by the kinematic model, in world coordinates
+  Telemetry& next = speculative_t_;
+  next = t;
+  next.steering_angle = act.steering_angle;
+  next.throttle = act.throttle;
+  const double delta = -act.steering_angle;
+  const int steps = int(ceil(frame_interval_ / kPredictionStep));
+  const double h = steps > 0 ? frame_interval_ / steps : 0;
+  for (int i = 0; i < steps; ++i) {
+    const double v = next.speed * kMphToMps;
+    next.x     += v*cos(next.psi)*h;
+    next.y     += v*sin(next.psi)*h;
+    next.psi   += v*delta/Lf*h;
+    next.speed += act.throttle*h;
+  }
+
+  const double max_cpu_time = mpc_.max_cpu_time();
+  mpc_.set_max_cpu_time(budget);
+  Solve(next, &speculative_out_, horizon);
+  mpc_.set_max_cpu_time(max_cpu_time);
+  speculative_cost_ = result_.cost;
+  speculated_ = true;
+  speculative_horizon_ = horizon;
+  speculations_++;
+}
+
+void Controller::Solve(const Telemetry& t, Actuation* out, int horizon) {
+  const double v = t.speed;
+  const double delta = -t.steering_angle;  // Adjust for negative steering angle
+  const double a = t.throttle;
+
+  // Way-points from the car's perspective: the path is fitted once per
+  // waypoint window and re-expressed relative to the car every frame.
+  PathCache::Coeffs coeffs =
+      path_cache_.LocalFit(t.ptsx, t.ptsy, t.n, t.x, t.y, t.psi);
+
+  const PathCache::Stats& cache_stats = path_cache_.stats();
+  if ((cache_stats.hits + cache_stats.misses) % kCacheReportInterval == 0) {
+    std::cout << "Path cache hit rate " << path_cache_.HitRate()
+              << " (" << cache_stats.hits << " hits, "
+              << cache_stats.misses << " misses)" << std::endl;
+  }
+
+  double cte = polyeval(coeffs, 0);
+  double epsi = atan(polyderiv(coeffs, 0));
+
+  // Latency adjustment: where the car will be by the time the actuation
+  // takes effect. The kinematic model the MPC optimizes over is integrated
+  // over the predicted latency, holding the current actuations.
+  const double dt_lat = latency();
+  double x0 = 0;
+  double y0 = 0;
+  double psi0 = 0;
+  double v0 = v;
+
+  const int steps = int(ceil(dt_lat / kPredictionStep));
+  const double h = steps > 0 ? dt_lat / steps : 0;
+  for (int i = 0; i < steps; ++i) {
+    const double f = polyeval(coeffs, x0);
+    cte   = (f - y0) + v0*sin(epsi)*h;
+    epsi += v0*delta/Lf*h;
+    x0   += v0*cos(psi0)*h;
+    y0   += v0*sin(psi0)*h;
+    psi0 += v0*delta/Lf*h;
+    v0   += a*h;
+  }
+
+  // Fill the state and solve
+  MPCState state;
+  state << x0, y0, psi0, v0, cte, epsi;
+
+  if (horizon == 0) horizon = horizon_;
+  mpc_.Solve(state, coeffs, &workspace_, &result_, size_t(horizon));
+
+  // NOTE: Remember to divide by deg2rad(25) before you send the steering
+  // value back. Otherwise the values will be in between
+  // [-deg2rad(25), deg2rad(25] instead of [-1, 1].
+  out->steering_angle = -result_.steering;  // Steering angle is negative in rotated coordinates
+  out->throttle = result_.throttle;
+
+  // Display the waypoints/reference line (Yellow line)
+  const int npoints = 10;
+  const double dn = 5.0;
+  out->n_next = npoints + 1;
+  for (int i = 1; i < npoints + 2; ++i) {
+    out->next_x[i - 1] = dn * i;
+  }
+  polyeval_batch(coeffs, out->next_x, out->n_next, out->next_y);
+
+  // Display the MPC predicted trajectory (Green line)
+  out->n_mpc = std::min(result_.n, int(Actuation::kMaxPathPoints));
+  for (int i = 0; i < out->n_mpc; ++i) {
+    out->mpc_x[i] = result_.x[i];
+    out->mpc_y[i] = result_.y[i];
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <chrono>
+#include "MPC.h"
+#include "path_cache.h"
+#include "plan_tracker.h"
+#include "telemetry.h"
+
+// The driving logic shared by all transports: fits the reference path,
+// compensates for the actuation latency and runs the MPC.
+class Controller {
+ public:
+  Controller();
+
+  // Compute the actuation for one telemetry frame, over a horizon of the
+  // given number of steps or the default one if 0. The MPC's plan is
+  // recorded in plan, if given, for tracking until the next solve.
+  void Step(const Telemetry& t, Actuation* out, int horizon = 0,
+            TrackedPlan* plan = nullptr);
+
+  // Solve ahead, within budget seconds of CPU time, for the frame expected
+  // next after t was answered with act: t moved on by the frame interval
+  // under that actuation. The next Step answers a frame close enough to
+  // the expected one with the result right away, and starts the solve for
+  // any other from it.
+  void Speculate(const Telemetry& t, const Actuation& act, int horizon,
+                 double budget);
+
+  // Record that a frame took this long from its arrival until its
+  // actuation was computed (seconds): queueing plus solving. Call it on the
+  // thread that runs Step.
+  void RecordProcessing(double seconds);
+
+  // Delay of the actuators once a reply is sent (seconds). The transports
+  // hold every reply back this long to mimic it.
+  double actuator_delay() const { return actuator_delay_; }
+
+  // Default horizon (steps), 0 for the MPC's own, and its terminal
+  // ingredients.
+  void set_horizon(int horizon) { horizon_ = horizon; }
+  void set_terminal(MPC::Terminal terminal) { mpc_.set_terminal(terminal); }
+  // Integrator and step length (seconds) of the MPC's model.
+  void set_integrator(Integrator integrator) {
+    mpc_.set_integrator(integrator);
+  }
+  void set_time_step(double seconds) { mpc_.set_time_step(seconds); }
+  // Whether the MPC's problem is scaled for the solver.
+  void set_scaling(bool scaling) { mpc_.set_scaling(scaling); }
+
+  // Latency the controller compensates for (seconds): the actuator delay
+  // plus the processing time expected from the recent frames.
+  double latency() const { return actuator_delay_ + processing_; }
+
+  // Cost of the MPC's solution the last Step answered with.
+  double cost() const { return cost_; }
+
+ private:
+  // Fit the path, predict the state over the latency and run the MPC.
+  void Solve(const Telemetry& t, Actuation* out, int horizon);
+
+  MPC mpc_;
+  // Buffers of its solves, and the result of the last one
+  MPCWorkspace workspace_;
+  SolveResult result_;
+  // Reference path fits, memoized per waypoint window
+  PathCache path_cache_;
+  int horizon_;
+  double actuator_delay_;
+  // Moving average of the processing time
+  double processing_;
+  // Moving average of the time between frames, and when the last came
+  double frame_interval_;
+  std::chrono::steady_clock::time_point last_step_;
+  long steps_;
+  // The frame expected next, its horizon and answer, if solved ahead
+  bool speculated_;
+  int speculative_horizon_;
+  Telemetry speculative_t_;
+  Actuation speculative_out_;
+  // Costs of the solutions behind the last answer and the speculative one
+  double cost_;
+  double speculative_cost_;
+  // Speculative solves, and those used as the answer
+  long speculations_;
+  long speculation_hits_;
+};
+
+#endif /* CONTROLLER_H */
@@ -0,0 +1,93 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <cmath>
+#include "Eigen-3.3/Eigen/Core"
+
+// Batch geometry kernels over structure-of-arrays point sets (separate x and
+// y arrays). The batch routines go through Eigen array maps so they pick up
+// Eigen's SIMD packet math. Unless noted otherwise, outputs must not alias
+// inputs.
+
+// Express global points in the frame of a body at (ox, oy) with heading psi.
+inline void ToLocalFrame(const double* gx, const double* gy, int n,
+                         double ox, double oy, double psi,
+                         double* lx, double* ly) {
+  const double c = std::cos(psi);
+  const double s = std::sin(psi);
+  Eigen::Map<const Eigen::ArrayXd> X(gx, n);
+  Eigen::Map<const Eigen::ArrayXd> Y(gy, n);
+  Eigen::Map<Eigen::ArrayXd> LX(lx, n);
+  Eigen::Map<Eigen::ArrayXd> LY(ly, n);
+  LX = (X - ox) * c + (Y - oy) * s;
+  LY = (Y - oy) * c - (X - ox) * s;
+}
+
+// Inverse of ToLocalFrame: body frame points back to the global frame.
+inline void ToGlobalFrame(const double* lx, const double* ly, int n,
+                          double ox, double oy, double psi,
+                          double* gx, double* gy) {
+  const double c = std::cos(psi);
+  const double s = std::sin(psi);
+  Eigen::Map<const Eigen::ArrayXd> LX(lx, n);
+  Eigen::Map<const Eigen::ArrayXd> LY(ly, n);
+  Eigen::Map<Eigen::ArrayXd> X(gx, n);
+  Eigen::Map<Eigen::ArrayXd> Y(gy, n);
+  X = LX * c - LY * s + ox;
+  Y = LX * s + LY * c + oy;
+}
+
+// Evaluate a polynomial at n points (Horner's rule, all points at once).
+template <typename Derived>
+inline void polyeval_batch(const Eigen::MatrixBase<Derived>& coeffs,
+                           const double* x, int n, double* y) {
+  Eigen::Map<const Eigen::ArrayXd> X(x, n);
+  Eigen::Map<Eigen::ArrayXd> Y(y, n);
+  const int k = int(coeffs.size());
+  Y.setConstant(coeffs[k - 1]);
+  for (int i = k - 2; i >= 0; --i) {
+    Y = Y * X + coeffs[i];
+  }
+}
+
+namespace geometry_internal {
+
+// pi/2 split in two parts (Cody-Waite) so the range reduction stays exact.
+const double kPio2Hi = 1.57079632673412561417e+00;
+const double kPio2Lo = 6.07710050650619224932e-11;
+const double kTwoOverPi = 6.36619772367581382433e-01;
+
+// Taylor polynomials for sin and cos on [-pi/4, pi/4].
+inline double SinPoly(double r) {
+  const double r2 = r * r;
+  return r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 +
+         r2 * (1.0 / 362880 + r2 * (-1.0 / 39916800 +
+         r2 * (1.0 / 6227020800))))));
+}
+
+inline double CosPoly(double r) {
+  const double r2 = r * r;
+  return 1.0 + r2 * (-1.0 / 2 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 +
+         r2 * (1.0 / 40320 + r2 * (-1.0 / 3628800 +
+         r2 * (1.0 / 479001600 + r2 * (-1.0 / 87178291200)))))));
+}
+
+}  // namespace geometry_internal
+
+// Fast sine and cosine of the same angle. The absolute error stays below
+// 1e-13 for |a| < 1e3, which covers any heading seen during a rollout.
+inline void fast_sincos(double a, double* s, double* c) {
+  using namespace geometry_internal;
+  const double k = std::floor(a * kTwoOverPi + 0.5);
+  const double r = (a - k * kPio2Hi) - k * kPio2Lo;
+  const double sr = SinPoly(r);
+  const double cr = CosPoly(r);
+  switch (int(k - 4.0 * std::floor(k * 0.25))) {
+    case 0: *s =  sr; *c =  cr; break;
+    case 1: *s =  cr; *c = -sr; break;
+    case 2: *s = -sr; *c = -cr; break;
+    default: *s = -cr; *c =  sr; break;
+  }
+}
+
+#endif /* GEOMETRY_H */
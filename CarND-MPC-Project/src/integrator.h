@@ -0,0 +1,103 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <cmath>
+
+// One step of the kinematic bicycle model of the MPC,
+//
+//   x' = v cos(psi), y' = v sin(psi), psi' = v delta / Lf, v' = a,
+//
+// with the actuations held over the step. Written for any scalar type with
+// the usual math functions, so the solver's AD types and plain doubles
+// share it.
+
+// How a step is integrated.
+enum Integrator {
+  // Explicit Euler, the original model: first order, so the time step has
+  // to stay small
+  kEuler,
+  // Explicit midpoint
+  kRK2,
+  // Classical fourth order Runge-Kutta
+  kRK4,
+  // Along the arc the step drives: its curvature delta / Lf depends on the
+  // steering only, so the model is integrated exactly
+  kExact,
+};
+
+template <class Scalar>
+struct Motion {
+  Scalar x;
+  Scalar y;
+  Scalar psi;
+  Scalar v;
+};
+
+// sin(u) / u, also near 0. Taped scalar types, which can't branch on
+// values, specialize it.
+template <class Scalar>
+Scalar Sinc(const Scalar& u) {
+  using std::abs;
+  using std::sin;
+  return abs(u) < 1e-4 ? Scalar(1.0 - u * u / 6.0) : Scalar(sin(u) / u);
+}
+
+template <class Scalar>
+Motion<Scalar> Derivative(const Motion<Scalar>& s, const Scalar& delta,
+                          const Scalar& a, double lf) {
+  using std::cos;
+  using std::sin;
+  return {s.v * cos(s.psi), s.v * sin(s.psi), s.v * delta / lf, a};
+}
+
+template <class Scalar>
+Motion<Scalar> Advance(const Motion<Scalar>& s, const Motion<Scalar>& d,
+                       double h) {
+  return {s.x + d.x * h, s.y + d.y * h, s.psi + d.psi * h, s.v + d.v * h};
+}
+
+// The state dt seconds after s.
+template <class Scalar>
+Motion<Scalar> Integrate(Integrator integrator, const Motion<Scalar>& s,
+                         const Scalar& delta, const Scalar& a, double dt,
+                         double lf) {
+  using std::cos;
+  using std::sin;
+  switch (integrator) {
+    case kEuler:
+      return Advance(s, Derivative(s, delta, a, lf), dt);
+    case kRK2: {
+      const Motion<Scalar> k1 = Derivative(s, delta, a, lf);
+      const Motion<Scalar> k2 =
+          Derivative(Advance(s, k1, dt / 2), delta, a, lf);
+      return Advance(s, k2, dt);
+    }
+    case kRK4: {
+      const Motion<Scalar> k1 = Derivative(s, delta, a, lf);
+      const Motion<Scalar> k2 =
+          Derivative(Advance(s, k1, dt / 2), delta, a, lf);
+      const Motion<Scalar> k3 =
+          Derivative(Advance(s, k2, dt / 2), delta, a, lf);
+      const Motion<Scalar> k4 = Derivative(Advance(s, k3, dt), delta, a, lf);
+      const Motion<Scalar> sum = {k1.x + 2.0 * (k2.x + k3.x) + k4.x,
+                                  k1.y + 2.0 * (k2.y + k3.y) + k4.y,
+                                  k1.psi + 2.0 * (k2.psi + k3.psi) + k4.psi,
+                                  k1.v + 2.0 * (k2.v + k3.v) + k4.v};
+      return Advance(s, sum, dt / 6);
+    }
+    case kExact:
+    default: {
+      // The arc is v dt long at the speed halfway through the step. Its
+      // chord, turning by dpsi, has length v dt sinc(dpsi/2) and points
+      // halfway through the turn.
+      const Scalar v = s.v + a * (dt / 2);
+      const Scalar dpsi = v * delta / lf * dt;
+      const Scalar chord = v * dt * Sinc<Scalar>(dpsi / 2);
+      return {s.x + chord * cos(s.psi + dpsi / 2),
+              s.y + chord * sin(s.psi + dpsi / 2), s.psi + dpsi,
+              s.v + a * dt};
+    }
+  }
+}
+
+#endif /* INTEGRATOR_H */
@@ -33,6 +33,7 @@ SOFTWARE.
 #include <array> // array
 #include <cassert> // assert
 #include <cctype> // isdigit
+#include <cfloat> // FLT_EVAL_METHOD
 #include <ciso646> // and, not, or
 #include <cmath> // isfinite, labs, ldexp, signbit
 #include <cstddef> // nullptr_t, ptrdiff_t, size_t
@@ -944,10 +945,870 @@ struct adl_serializer
 };
 
 
+/*!
+@brief ordered associative container stored in a flat sorted vector
+
+Drop-in replacement for `std::map` as the @a ObjectType template argument of
+@ref basic_json (e.g. `basic_json<flat_map>`). Elements are kept sorted by
+key in a single contiguous buffer, so an object costs one allocation instead
+of one node per key, and lookups scan cache-friendly memory instead of
+chasing tree pointers. This pays off for small objects (up to a few dozen
+keys): lookups in them are a linear scan for an equal key, larger objects
+use binary search.
+
+Unlike `std::map`, the key of a stored element is not `const`, and
+insertion or erasure invalidates iterators just like `std::vector`.
+
+@tparam Key        key type
+@tparam T          mapped type
+@tparam Compare    strict weak ordering of the keys
+@tparam Allocator  allocator; rebound to the stored `std::pair<Key, T>`
+*/
+template<class Key, class T, class Compare = std::less<Key>,
+         class Allocator = std::allocator<std::pair<const Key, T>>>
+class flat_map
+{
+  public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using container_type = std::vector<value_type, allocator_type>;
+    using size_type = typename container_type::size_type;
+    using difference_type = typename container_type::difference_type;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+    using reverse_iterator = typename container_type::reverse_iterator;
+    using const_reverse_iterator = typename container_type::const_reverse_iterator;
+
+    /// objects up to this size are searched linearly by find()
+    static constexpr size_type linear_search_limit = 16;
+
+    flat_map() = default;
+
+    explicit flat_map(const allocator_type& alloc)
+        : m_data(alloc)
+    {}
+
+    template<class InputIt>
+    flat_map(InputIt first, InputIt last)
+    {
+        insert(first, last);
+    }
+
+    flat_map(std::initializer_list<value_type> init)
+    {
+        insert(init.begin(), init.end());
+    }
+
+    allocator_type get_allocator() const
+    {
+        return m_data.get_allocator();
+    }
+
+    key_compare key_comp() const
+    {
+        return m_comp;
+    }
+
+    iterator begin() noexcept
+    {
+        return m_data.begin();
+    }
+    const_iterator begin() const noexcept
+    {
+        return m_data.begin();
+    }
+    const_iterator cbegin() const noexcept
+    {
+        return m_data.cbegin();
+    }
+    iterator end() noexcept
+    {
+        return m_data.end();
+    }
+    const_iterator end() const noexcept
+    {
+        return m_data.end();
+    }
+    const_iterator cend() const noexcept
+    {
+        return m_data.cend();
+    }
+    reverse_iterator rbegin() noexcept
+    {
+        return m_data.rbegin();
+    }
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return m_data.rbegin();
+    }
+    reverse_iterator rend() noexcept
+    {
+        return m_data.rend();
+    }
+    const_reverse_iterator rend() const noexcept
+    {
+        return m_data.rend();
+    }
+
+    bool empty() const noexcept
+    {
+        return m_data.empty();
+    }
+    size_type size() const noexcept
+    {
+        return m_data.size();
+    }
+    size_type max_size() const noexcept
+    {
+        return m_data.max_size();
+    }
+    size_type capacity() const noexcept
+    {
+        return m_data.capacity();
+    }
+    void reserve(size_type n)
+    {
+        m_data.reserve(n);
+    }
+    void clear() noexcept
+    {
+        m_data.clear();
+    }
+
+    /// access or insert (default-constructed) the value for @a key
+    T& operator[](const key_type& key)
+    {
+        auto it = lower_bound(key);
+        if (it == m_data.end() or m_comp(key, it->first))
+        {
+            it = m_data.emplace(it, key, T());
+        }
+        return it->second;
+    }
+
+    /// @copydoc operator[](const key_type&)
+    T& operator[](key_type&& key)
+    {
+        auto it = lower_bound(key);
+        if (it == m_data.end() or m_comp(key, it->first))
+        {
+            it = m_data.emplace(it, std::move(key), T());
+        }
+        return it->second;
+    }
+
+    /// access the value for @a key; throws std::out_of_range if missing
+    T& at(const key_type& key)
+    {
+        auto it = find(key);
+        if (it == m_data.end())
+        {
+            JSON_THROW(std::out_of_range("flat_map::at: key not found"));
+        }
+        return it->second;
+    }
+
+    /// @copydoc at(const key_type&)
+    const T& at(const key_type& key) const
+    {
+        auto it = find(key);
+        if (it == m_data.end())
+        {
+            JSON_THROW(std::out_of_range("flat_map::at: key not found"));
+        }
+        return it->second;
+    }
+
+    iterator lower_bound(const key_type& key)
+    {
+        return m_data.begin() + lower_bound_index(key);
+    }
+
+    const_iterator lower_bound(const key_type& key) const
+    {
+        return m_data.begin() + lower_bound_index(key);
+    }
+
+    iterator find(const key_type& key)
+    {
+        return m_data.begin() + find_index(key);
+    }
+
+    const_iterator find(const key_type& key) const
+    {
+        return m_data.begin() + find_index(key);
+    }
+
+    size_type count(const key_type& key) const
+    {
+        return find(key) == m_data.end() ? 0 : 1;
+    }
+
+    /// insert @a value unless its key is present
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return emplace(value);
+    }
+
+    /// @copydoc insert(const value_type&)
+    std::pair<iterator, bool> insert(value_type&& value)
+    {
+        return emplace(std::move(value));
+    }
+
+    template<class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for (; first != last; ++first)
+        {
+            emplace(*first);
+        }
+    }
+
+    /// construct a value in place unless its key is present
+    template<class... Args>
+    std::pair<iterator, bool> emplace(Args&& ... args)
+    {
+        value_type value(std::forward<Args>(args)...);
+        auto it = lower_bound(value.first);
+        if (it != m_data.end() and not m_comp(value.first, it->first))
+        {
+            return {it, false};
+        }
+        return {m_data.insert(it, std::move(value)), true};
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        return m_data.erase(pos);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        return m_data.erase(first, last);
+    }
+
+    size_type erase(const key_type& key)
+    {
+        auto it = find(key);
+        if (it == m_data.end())
+        {
+            return 0;
+        }
+        m_data.erase(it);
+        return 1;
+    }
+
+    void swap(flat_map& other) noexcept
+    {
+        using std::swap;
+        swap(m_data, other.m_data);
+        swap(m_comp, other.m_comp);
+    }
+
+    friend bool operator==(const flat_map& lhs, const flat_map& rhs)
+    {
+        return lhs.m_data == rhs.m_data;
+    }
+    friend bool operator!=(const flat_map& lhs, const flat_map& rhs)
+    {
+        return lhs.m_data != rhs.m_data;
+    }
+    friend bool operator<(const flat_map& lhs, const flat_map& rhs)
+    {
+        return lhs.m_data < rhs.m_data;
+    }
+    friend bool operator<=(const flat_map& lhs, const flat_map& rhs)
+    {
+        return lhs.m_data <= rhs.m_data;
+    }
+    friend bool operator>(const flat_map& lhs, const flat_map& rhs)
+    {
+        return lhs.m_data > rhs.m_data;
+    }
+    friend bool operator>=(const flat_map& lhs, const flat_map& rhs)
+    {
+        return lhs.m_data >= rhs.m_data;
+    }
+
+  private:
+    /// index of the first element whose key is not less than @a key
+    size_type lower_bound_index(const key_type& key) const
+    {
+        return static_cast<size_type>(std::lower_bound(m_data.begin(), m_data.end(), key,
+                                      [this](const value_type & v, const key_type & k)
+        {
+            return m_comp(v.first, k);
+        }) - m_data.begin());
+    }
+
+    /// index of the element with key @a key, or size() if there is none
+    size_type find_index(const key_type& key) const
+    {
+        // for small objects ordered by the default std::less, a linear scan
+        // for equality beats the binary search: most candidate keys are
+        // rejected on their length alone
+        if (std::is_same<Compare, std::less<Key>>::value and
+                m_data.size() <= linear_search_limit)
+        {
+            size_type i = 0;
+            while (i < m_data.size() and not (m_data[i].first == key))
+            {
+                ++i;
+            }
+            return i;
+        }
+
+        const size_type i = lower_bound_index(key);
+        return (i == m_data.size() or m_comp(key, m_data[i].first)) ? m_data.size() : i;
+    }
+
+    /// the elements, sorted by key
+    container_type m_data;
+    /// the key ordering
+    key_compare m_comp;
+};
+
+template<class Key, class T, class Compare, class Allocator>
+constexpr typename flat_map<Key, T, Compare, Allocator>::size_type
+flat_map<Key, T, Compare, Allocator>::linear_search_limit;
+
+
+namespace detail
+{
+/*!
+@brief shortest round-trip formatting of doubles (Grisu2)
+
+Implements the Grisu2 algorithm of Florian Loitsch, "Printing Floating-Point
+Numbers Quickly and Accurately with Integers" (PLDI 2010), following the
+formulation with a single cached power per exponent range as in Alexander
+Bolz's "Drachennest". The generated digits always read back to the same
+double; in rare cases they are one digit longer than the shortest such
+string.
+*/
+namespace dtoa
+{
+/// a normalized or unnormalized "do-it-yourself" floating-point number f * 2^e
+struct diyfp
+{
+    std::uint64_t f;
+    int e;
+
+    constexpr diyfp(std::uint64_t f_, int e_) noexcept : f(f_), e(e_) {}
+
+    /// x - y for equal exponents and x.f >= y.f
+    static diyfp sub(const diyfp& x, const diyfp& y) noexcept
+    {
+        assert(x.e == y.e);
+        assert(x.f >= y.f);
+        return diyfp(x.f - y.f, x.e);
+    }
+
+    /// x * y, rounded to the upper 64 bits of the 128-bit product
+    static diyfp mul(const diyfp& x, const diyfp& y) noexcept
+    {
+        const std::uint64_t u_lo = x.f & 0xFFFFFFFFu;
+        const std::uint64_t u_hi = x.f >> 32u;
+        const std::uint64_t v_lo = y.f & 0xFFFFFFFFu;
+        const std::uint64_t v_hi = y.f >> 32u;
+
+        const std::uint64_t p0 = u_lo * v_lo;
+        const std::uint64_t p1 = u_lo * v_hi;
+        const std::uint64_t p2 = u_hi * v_lo;
+        const std::uint64_t p3 = u_hi * v_hi;
+
+        std::uint64_t q = (p0 >> 32u) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+        q += std::uint64_t(1) << 31u; // round, ties up
+
+        const std::uint64_t h = p3 + (p2 >> 32u) + (p1 >> 32u) + (q >> 32u);
+        return diyfp(h, x.e + y.e + 64);
+    }
+
+    /// shift left until the most significant bit is set
+    static diyfp normalize(diyfp x) noexcept
+    {
+        assert(x.f != 0);
+        while ((x.f >> 63u) == 0)
+        {
+            x.f <<= 1u;
+            x.e--;
+        }
+        return x;
+    }
+
+    /// shift left to the (smaller) target exponent
+    static diyfp normalize_to(const diyfp& x, const int target_exponent) noexcept
+    {
+        const int delta = x.e - target_exponent;
+        assert(delta >= 0);
+        assert(((x.f << delta) >> delta) == x.f);
+        return diyfp(x.f << delta, target_exponent);
+    }
+};
+
+/// v and the boundaries m- and m+ of its rounding interval
+struct boundaries
+{
+    diyfp w;
+    diyfp minus;
+    diyfp plus;
+};
+
+/// compute the normalized v and its (normalized) rounding boundaries
+inline boundaries compute_boundaries(double value)
+{
+    assert(std::isfinite(value));
+    assert(value > 0);
+
+    constexpr int precision = std::numeric_limits<double>::digits; // 53
+    constexpr int bias = std::numeric_limits<double>::max_exponent - 1 + (precision - 1);
+    constexpr int min_exp = 1 - bias;
+    constexpr std::uint64_t hidden_bit = std::uint64_t(1) << (precision - 1);
+
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const std::uint64_t E = bits >> (precision - 1);
+    const std::uint64_t F = bits & (hidden_bit - 1);
+
+    const bool is_denormal = (E == 0);
+    const diyfp v = is_denormal
+                    ? diyfp(F, min_exp)
+                    : diyfp(F + hidden_bit, static_cast<int>(E) - bias);
+
+    // the lower boundary is closer iff the significand is a power of two
+    // (and the next smaller exponent is not the denormal one)
+    const bool lower_boundary_is_closer = (F == 0 and E > 1);
+    const diyfp m_plus = diyfp(2 * v.f + 1, v.e - 1);
+    const diyfp m_minus = lower_boundary_is_closer
+                          ? diyfp(4 * v.f - 1, v.e - 2)
+                          : diyfp(2 * v.f - 1, v.e - 1);
+
+    const diyfp w_plus = diyfp::normalize(m_plus);
+    const diyfp w_minus = diyfp::normalize_to(m_minus, w_plus.e);
+
+    return {diyfp::normalize(v), w_minus, w_plus};
+}
+
+// the scaled product of v and the cached power must have its binary exponent
+// in [alpha, gamma] so that the integral part fits into 32 bits
+constexpr int kAlpha = -60;
+constexpr int kGamma = -32;
+
+/// c = f * 2^e ~= 10^k
+struct cached_power
+{
+    std::uint64_t f;
+    int e;
+    int k;
+};
+
+/// the cached power c = 10^-k such that alpha <= e + c.e + 64 <= gamma
+inline cached_power get_cached_power_for_binary_exponent(int e)
+{
+    constexpr int kCachedPowersMinDecExp = -300;
+    constexpr int kCachedPowersDecStep = 8;
+
+    static const cached_power kCachedPowers[] =
+    {
+            { 0xAB70FE17C79AC6CA, -1060,  -300 },
+            { 0xFF77B1FCBEBCDC4F, -1034,  -292 },
+            { 0xBE5691EF416BD60C, -1007,  -284 },
+            { 0x8DD01FAD907FFC3C,  -980,  -276 },
+            { 0xD3515C2831559A83,  -954,  -268 },
+            { 0x9D71AC8FADA6C9B5,  -927,  -260 },
+            { 0xEA9C227723EE8BCB,  -901,  -252 },
+            { 0xAECC49914078536D,  -874,  -244 },
+            { 0x823C12795DB6CE57,  -847,  -236 },
+            { 0xC21094364DFB5637,  -821,  -228 },
+            { 0x9096EA6F3848984F,  -794,  -220 },
+            { 0xD77485CB25823AC7,  -768,  -212 },
+            { 0xA086CFCD97BF97F4,  -741,  -204 },
+            { 0xEF340A98172AACE5,  -715,  -196 },
+            { 0xB23867FB2A35B28E,  -688,  -188 },
+            { 0x84C8D4DFD2C63F3B,  -661,  -180 },
+            { 0xC5DD44271AD3CDBA,  -635,  -172 },
+            { 0x936B9FCEBB25C996,  -608,  -164 },
+            { 0xDBAC6C247D62A584,  -582,  -156 },
+            { 0xA3AB66580D5FDAF6,  -555,  -148 },
+            { 0xF3E2F893DEC3F126,  -529,  -140 },
+            { 0xB5B5ADA8AAFF80B8,  -502,  -132 },
+            { 0x87625F056C7C4A8B,  -475,  -124 },
+            { 0xC9BCFF6034C13053,  -449,  -116 },
+            { 0x964E858C91BA2655,  -422,  -108 },
+            { 0xDFF9772470297EBD,  -396,  -100 },
+            { 0xA6DFBD9FB8E5B88F,  -369,   -92 },
+            { 0xF8A95FCF88747D94,  -343,   -84 },
+            { 0xB94470938FA89BCF,  -316,   -76 },
+            { 0x8A08F0F8BF0F156B,  -289,   -68 },
+            { 0xCDB02555653131B6,  -263,   -60 },
+            { 0x993FE2C6D07B7FAC,  -236,   -52 },
+            { 0xE45C10C42A2B3B06,  -210,   -44 },
+            { 0xAA242499697392D3,  -183,   -36 },
+            { 0xFD87B5F28300CA0E,  -157,   -28 },
+            { 0xBCE5086492111AEB,  -130,   -20 },
+            { 0x8CBCCC096F5088CC,  -103,   -12 },
+            { 0xD1B71758E219652C,   -77,    -4 },
+            { 0x9C40000000000000,   -50,     4 },
+            { 0xE8D4A51000000000,   -24,    12 },
+            { 0xAD78EBC5AC620000,     3,    20 },
+            { 0x813F3978F8940984,    30,    28 },
+            { 0xC097CE7BC90715B3,    56,    36 },
+            { 0x8F7E32CE7BEA5C70,    83,    44 },
+            { 0xD5D238A4ABE98068,   109,    52 },
+            { 0x9F4F2726179A2245,   136,    60 },
+            { 0xED63A231D4C4FB27,   162,    68 },
+            { 0xB0DE65388CC8ADA8,   189,    76 },
+            { 0x83C7088E1AAB65DB,   216,    84 },
+            { 0xC45D1DF942711D9A,   242,    92 },
+            { 0x924D692CA61BE758,   269,   100 },
+            { 0xDA01EE641A708DEA,   295,   108 },
+            { 0xA26DA3999AEF774A,   322,   116 },
+            { 0xF209787BB47D6B85,   348,   124 },
+            { 0xB454E4A179DD1877,   375,   132 },
+            { 0x865B86925B9BC5C2,   402,   140 },
+            { 0xC83553C5C8965D3D,   428,   148 },
+            { 0x952AB45CFA97A0B3,   455,   156 },
+            { 0xDE469FBD99A05FE3,   481,   164 },
+            { 0xA59BC234DB398C25,   508,   172 },
+            { 0xF6C69A72A3989F5C,   534,   180 },
+            { 0xB7DCBF5354E9BECE,   561,   188 },
+            { 0x88FCF317F22241E2,   588,   196 },
+            { 0xCC20CE9BD35C78A5,   614,   204 },
+            { 0x98165AF37B2153DF,   641,   212 },
+            { 0xE2A0B5DC971F303A,   667,   220 },
+            { 0xA8D9D1535CE3B396,   694,   228 },
+            { 0xFB9B7CD9A4A7443C,   720,   236 },
+            { 0xBB764C4CA7A44410,   747,   244 },
+            { 0x8BAB8EEFB6409C1A,   774,   252 },
+            { 0xD01FEF10A657842C,   800,   260 },
+            { 0x9B10A4E5E9913129,   827,   268 },
+            { 0xE7109BFBA19C0C9D,   853,   276 },
+            { 0xAC2820D9623BF429,   880,   284 },
+            { 0x80444B5E7AA7CF85,   907,   292 },
+            { 0xBF21E44003ACDD2D,   933,   300 },
+            { 0x8E679C2F5E44FF8F,   960,   308 },
+            { 0xD433179D9C8CB841,   986,   316 },
+            { 0x9E19DB92B4E31BA9,  1013,   324 }
+    };
+
+    // ceil(log10(2^(alpha - e - 1))), with log10(2) ~= 78913 / 2^18
+    const int f = kAlpha - e - 1;
+    const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+
+    const int index = (-kCachedPowersMinDecExp + k + (kCachedPowersDecStep - 1)) / kCachedPowersDecStep;
+    assert(index >= 0);
+    assert(static_cast<std::size_t>(index) < sizeof(kCachedPowers) / sizeof(kCachedPowers[0]));
+
+    const cached_power cached = kCachedPowers[static_cast<std::size_t>(index)];
+    assert(kAlpha <= cached.e + e + 64);
+    assert(kGamma >= cached.e + e + 64);
+
+    return cached;
+}
+
+/// largest power of ten <= n; returns its number of digits
+inline int find_largest_pow10(const std::uint32_t n, std::uint32_t& pow10)
+{
+    static const std::uint32_t powers[] =
+    {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+    int digits = 10;
+    while (digits > 1 and n < powers[digits - 1])
+    {
+        --digits;
+    }
+    pow10 = powers[digits - 1];
+    return digits;
+}
+
+/// move the last digit towards w as long as the result stays in range
+inline void grisu2_round(char* buf, int len, std::uint64_t dist, std::uint64_t delta,
+                         std::uint64_t rest, std::uint64_t ten_k)
+{
+    assert(len >= 1);
+    assert(dist <= delta);
+    assert(rest <= delta);
+    assert(ten_k > 0);
+
+    while (rest < dist
+            and delta - rest >= ten_k
+            and (rest + ten_k < dist or dist - rest > rest + ten_k - dist))
+    {
+        assert(buf[len - 1] != '0');
+        buf[len - 1]--;
+        rest += ten_k;
+    }
+}
+
+/// generate the digits of a number in [M-, M+] as close to w as possible
+inline void grisu2_digit_gen(char* buffer, int& length, int& decimal_exponent,
+                             diyfp M_minus, diyfp w, diyfp M_plus)
+{
+    assert(M_plus.e >= kAlpha);
+    assert(M_plus.e <= kGamma);
+
+    std::uint64_t delta = diyfp::sub(M_plus, M_minus).f;
+    std::uint64_t dist = diyfp::sub(M_plus, w).f;
+
+    // split M+ = p1 + p2 * 2^e into integral and fractional part
+    const diyfp one(std::uint64_t(1) << -M_plus.e, M_plus.e);
+
+    std::uint32_t p1 = static_cast<std::uint32_t>(M_plus.f >> -one.e);
+    std::uint64_t p2 = M_plus.f & (one.f - 1);
+
+    // integral digits
+    std::uint32_t pow10 = 0;
+    int n = find_largest_pow10(p1, pow10);
+
+    while (n > 0)
+    {
+        const std::uint32_t d = p1 / pow10;
+        const std::uint32_t r = p1 % pow10;
+        assert(d <= 9);
+        buffer[length++] = static_cast<char>('0' + d);
+        p1 = r;
+        n--;
+
+        const std::uint64_t rest = (std::uint64_t(p1) << -one.e) + p2;
+        if (rest <= delta)
+        {
+            decimal_exponent += n;
+            grisu2_round(buffer, length, dist, delta, rest, std::uint64_t(pow10) << -one.e);
+            return;
+        }
+
+        pow10 /= 10;
+    }
+
+    // fractional digits
+    int m = 0;
+    for (;;)
+    {
+        assert(p2 <= (std::numeric_limits<std::uint64_t>::max)() / 10);
+        p2 *= 10;
+        const std::uint64_t d = p2 >> -one.e;
+        const std::uint64_t r = p2 & (one.f - 1);
+        assert(d <= 9);
+        buffer[length++] = static_cast<char>('0' + d);
+        p2 = r;
+        m++;
+
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta)
+        {
+            break;
+        }
+    }
+
+    decimal_exponent -= m;
+    grisu2_round(buffer, length, dist, delta, p2, one.f);
+}
+
+/// digits of a positive finite double v = digits * 10^decimal_exponent
+inline void grisu2(char* buf, int& len, int& decimal_exponent, double value)
+{
+    const boundaries b = compute_boundaries(value);
+
+    const cached_power cached = get_cached_power_for_binary_exponent(b.plus.e);
+    const diyfp c_minus_k(cached.f, cached.e);
+
+    const diyfp w = diyfp::mul(b.w, c_minus_k);
+    const diyfp w_minus = diyfp::mul(b.minus, c_minus_k);
+    const diyfp w_plus = diyfp::mul(b.plus, c_minus_k);
+
+    // shrink the interval by one ulp on both ends to stay safe from the
+    // rounding errors of the multiplications
+    const diyfp M_minus(w_minus.f + 1, w_minus.e);
+    const diyfp M_plus(w_plus.f - 1, w_plus.e);
+
+    len = 0;
+    decimal_exponent = -cached.k;
+    grisu2_digit_gen(buf, len, decimal_exponent, M_minus, w, M_plus);
+}
+
+/// round the digit string to at most @a precision significant digits
+inline void round_digits(char* buf, int& len, int& decimal_exponent, int precision)
+{
+    if (precision <= 0 or len <= precision)
+    {
+        return;
+    }
+
+    const bool round_up = (buf[precision] >= '5');
+    decimal_exponent += len - precision;
+    len = precision;
+
+    if (round_up)
+    {
+        int i = len - 1;
+        while (i >= 0 and buf[i] == '9')
+        {
+            --i;
+        }
+        if (i < 0)
+        {
+            // 99..9 -> 1
+            buf[0] = '1';
+            decimal_exponent += len;
+            len = 1;
+        }
+        else
+        {
+            buf[i]++;
+            decimal_exponent += len - 1 - i;
+            len = i + 1;
+        }
+    }
+
+    // drop trailing zeros
+    while (len > 1 and buf[len - 1] == '0')
+    {
+        --len;
+        ++decimal_exponent;
+    }
+}
+
+/// append the exponent e (|e| < 1000) as "e+dd" / "e-ddd"
+inline char* append_exponent(char* buf, int e)
+{
+    *buf++ = 'e';
+    if (e < 0)
+    {
+        e = -e;
+        *buf++ = '-';
+    }
+    else
+    {
+        *buf++ = '+';
+    }
+
+    const unsigned k = static_cast<unsigned>(e);
+    if (k >= 100)
+    {
+        *buf++ = static_cast<char>('0' + k / 100);
+        *buf++ = static_cast<char>('0' + k / 10 % 10);
+    }
+    else if (k >= 10)
+    {
+        *buf++ = static_cast<char>('0' + k / 10);
+    }
+    *buf++ = static_cast<char>('0' + k % 10);
+    return buf;
+}
+
+/*!
+@brief lay out the digits buf[0, len) * 10^decimal_exponent as JSON number
+
+Numbers whose decimal point falls within [-4, 15] digits are written in
+fixed notation, all others in scientific notation. Integral values keep a
+trailing ".0" so that they are read back as floating-point numbers.
+
+@return the end of the written characters; @a buf must have room for
+        len + 23 characters
+*/
+inline char* format_buffer(char* buf, int len, int decimal_exponent)
+{
+    constexpr int min_exp = -4;
+    constexpr int max_exp = std::numeric_limits<double>::digits10;
+
+    const int k = len;
+    const int n = len + decimal_exponent;
+
+    if (k <= n and n <= max_exp)
+    {
+        // digits[000].0
+        std::memset(buf + k, '0', static_cast<std::size_t>(n - k));
+        buf[n] = '.';
+        buf[n + 1] = '0';
+        return buf + (n + 2);
+    }
+
+    if (0 < n and n <= max_exp)
+    {
+        // dig.its
+        std::memmove(buf + (n + 1), buf + n, static_cast<std::size_t>(k - n));
+        buf[n] = '.';
+        return buf + (k + 1);
+    }
+
+    if (min_exp < n and n <= 0)
+    {
+        // 0.[000]digits
+        std::memmove(buf + (2 + -n), buf, static_cast<std::size_t>(k));
+        buf[0] = '0';
+        buf[1] = '.';
+        std::memset(buf + 2, '0', static_cast<std::size_t>(-n));
+        return buf + (2 + (-n) + k);
+    }
+
+    if (k == 1)
+    {
+        // dE+123
+        buf += 1;
+    }
+    else
+    {
+        // d.igitsE+123
+        std::memmove(buf + 2, buf + 1, static_cast<std::size_t>(k - 1));
+        buf[1] = '.';
+        buf += 1 + k;
+    }
+
+    return append_exponent(buf, n - 1);
+}
+
+/*!
+@brief write a finite double as JSON number into [first, ...)
+
+@param[in] precision  0 for the shortest representation that reads back to
+                      the same value, otherwise the maximal number of
+                      significant digits
+@return the end of the written characters; the buffer must hold at least
+        32 characters
+*/
+inline char* to_chars(char* first, double value, int precision = 0)
+{
+    assert(std::isfinite(value));
+
+    if (std::signbit(value))
+    {
+        value = -value;
+        *first++ = '-';
+    }
+
+    if (value == 0)
+    {
+        *first++ = '0';
+        *first++ = '.';
+        *first++ = '0';
+        return first;
+    }
+
+    int len = 0;
+    int decimal_exponent = 0;
+    grisu2(first, len, decimal_exponent, value);
+    assert(len <= std::numeric_limits<double>::max_digits10);
+
+    round_digits(first, len, decimal_exponent, precision);
+
+    return format_buffer(first, len, decimal_exponent);
+}
+} // namespace dtoa
+} // namespace detail
+
+
 /*!
 @brief a class to store JSON values
 
-@tparam ObjectType type for JSON objects (`std::map` by default; will be used
+@tparam ObjectType type for JSON objects (`std::map` by default, @ref flat_map
+for small objects; will be used
 in @ref object_t)
 @tparam ArrayType type for JSON arrays (`std::vector` by default; will be used
 in @ref array_t)
@@ -2646,18 +3507,37 @@ class basic_json
     */
     string_t dump(const int indent = -1) const
     {
-        std::stringstream ss;
+        string_t result;
+        dump_to(result, indent);
+        return result;
+    }
+
+    /*!
+    @brief serialization into a caller-provided buffer
+
+    Appends the serialization of the JSON value to @a out. Unlike @ref dump,
+    no string is returned and no stream is involved, so a buffer that is
+    cleared and reused keeps its capacity across calls.
 
+    @param[in,out] out        buffer to append to
+    @param[in] indent         as for @ref dump
+    @param[in] float_precision  if positive, floating-point numbers are
+    rounded to at most this many significant digits (useful for values that
+    are only displayed); `0` (the default) writes the shortest representation
+    that reads back to the same value
+
+    @complexity Linear.
+    */
+    void dump_to(string_t& out, const int indent = -1, const int float_precision = 0) const
+    {
         if (indent >= 0)
         {
-            dump(ss, true, static_cast<unsigned int>(indent));
+            dump(out, true, static_cast<unsigned int>(indent), float_precision);
         }
         else
         {
-            dump(ss, false, 0);
+            dump(out, false, 0, float_precision);
         }
-
-        return ss.str();
     }
 
     /*!
@@ -6229,7 +7109,9 @@ class basic_json
         o.width(0);
 
         // do the actual serialization
-        j.dump(o, pretty_print, static_cast<unsigned int>(indentation));
+        string_t s;
+        j.dump(s, pretty_print, static_cast<unsigned int>(indentation), 0);
+        o.write(s.data(), static_cast<std::streamsize>(s.size()));
 
         return o;
     }
@@ -6488,6 +7370,111 @@ class basic_json
         return parse(std::begin(c), std::end(c), cb);
     }
 
+    /*!
+    @brief deserialize from string literal into an existing value
+
+    Consecutive messages of a protocol usually share their shape. Instead of
+    building a new value, this overwrites @a result in place: arrays, objects
+    and strings that already have the type of the parsed value keep their
+    storage and are updated element by element, so a same-shaped input only
+    rewrites scalars and does not allocate. Surplus array elements and object
+    members are removed, missing ones are added. Wherever the types differ,
+    that part of @a result is rebuilt as @ref parse would.
+
+    @param[in,out] result  value to parse into
+    @param[in] s  string literal to read a serialized JSON value from
+
+    @throw std::invalid_argument in case of a parse error; @a result is then
+    left in a valid but unspecified state
+
+    @complexity Linear in the length of the input plus the size of @a result.
+
+    @sa @ref parse(const CharT, const parser_callback_t) for the version that
+    builds a new value
+    */
+    template<typename CharT, typename std::enable_if<
+                 std::is_pointer<CharT>::value and
+                 std::is_integral<typename std::remove_pointer<CharT>::type>::value and
+                 sizeof(typename std::remove_pointer<CharT>::type) == 1, int>::type = 0>
+    static void parse_into(basic_json& result, const CharT s)
+    {
+        parser(reinterpret_cast<const char*>(s)).parse_into(result);
+    }
+
+    /*!
+    @brief deserialize from an array into an existing value
+
+    Same as @ref parse_into(basic_json&, const CharT), reading from an array
+    (including a string literal passed by reference).
+
+    @param[in,out] result  value to parse into
+    @param[in] array  array to read from
+
+    @throw std::invalid_argument in case of a parse error
+    */
+    template<class T, std::size_t N>
+    static void parse_into(basic_json& result, T (&array)[N])
+    {
+        static_assert(sizeof(T) == 1, "each element in the array must have the size of 1 byte");
+        parser(std::begin(array), std::end(array)).parse_into(result);
+    }
+
+    /*!
+    @brief deserialize from an iterator range with contiguous storage into an
+           existing value
+
+    Same as @ref parse_into(basic_json&, const CharT), reading from a range
+    such as a span of a larger, not null-terminated message buffer.
+
+    @param[in,out] result  value to parse into
+    @param[in] first  begin of the range to parse (included)
+    @param[in] last  end of the range to parse (excluded)
+
+    @throw std::invalid_argument in case of a parse error
+    */
+    template<class IteratorType, typename std::enable_if<
+                 std::is_base_of<
+                     std::random_access_iterator_tag,
+                     typename std::iterator_traits<IteratorType>::iterator_category>::value, int>::type = 0>
+    static void parse_into(basic_json& result, IteratorType first, IteratorType last)
+    {
+        static_assert(sizeof(typename std::iterator_traits<IteratorType>::value_type) == 1,
+                      "each element in the iterator range must have the size of 1 byte");
+
+        // an empty range yields the "unexpected EOF" error message
+        if (std::distance(first, last) <= 0)
+        {
+            parser("").parse_into(result);
+            return;
+        }
+
+        parser(first, last).parse_into(result);
+    }
+
+    /*!
+    @brief deserialize from a container with contiguous storage into an
+           existing value
+
+    Same as @ref parse_into(basic_json&, const CharT), reading from a
+    container such as `std::string`.
+
+    @param[in,out] result  value to parse into
+    @param[in] c  container to read from
+
+    @throw std::invalid_argument in case of a parse error
+    */
+    template<class ContiguousContainer, typename std::enable_if<
+                 not std::is_pointer<ContiguousContainer>::value and
+                 std::is_base_of<
+                     std::random_access_iterator_tag,
+                     typename std::iterator_traits<decltype(std::begin(std::declval<ContiguousContainer const>()))>::iterator_category>::value
+                 , int>::type = 0>
+    static void parse_into(basic_json& result, const ContiguousContainer& c)
+    {
+        // delegate the call to the iterator-range parse_into overload
+        parse_into(result, std::begin(c), std::end(c));
+    }
+
     /*!
     @brief deserialize from stream
 
@@ -6536,6 +7523,38 @@ class basic_json
     /// @name binary serialization/deserialization support
     /// @{
 
+    /*!
+    @brief visitor interface for streaming MessagePack/CBOR decoding
+
+    @ref sax_parse_msgpack and @ref sax_parse_cbor report every decoded
+    item to a visitor instead of building a JSON value. A visitor is any type
+    with the member functions below; they are called statically, so there is
+    no virtual dispatch. Deriving from this class and hiding only the events
+    of interest ignores all others.
+
+    Events arrive in document order. Containers report their length on
+    start (`std::string::npos` for indefinite-length CBOR items), and every
+    object member is announced by a `key` event before its value. Strings
+    and keys are passed as pointer and length into the input buffer where
+    possible; they are only valid during the call.
+
+    @since version 2.1.1
+    */
+    struct binary_sax
+    {
+        void null() {}
+        void boolean(bool) {}
+        void number_integer(number_integer_t) {}
+        void number_unsigned(number_unsigned_t) {}
+        void number_float(number_float_t) {}
+        void string(const char*, size_t) {}
+        void start_object(size_t) {}
+        void key(const char*, size_t) {}
+        void end_object() {}
+        void start_array(size_t) {}
+        void end_array() {}
+    };
+
   private:
     /*!
     @note Some code in the switch cases has been copied, because otherwise
@@ -6587,21 +7606,22 @@ class basic_json
     }
 
     /*!
-    @brief take sufficient bytes from a vector to fill an integer variable
+    @brief take sufficient bytes from a buffer to fill an integer variable
 
     In the context of binary serialization formats, we need to read several
-    bytes from a byte vector and combine them to multi-byte integral data
+    bytes from a byte buffer and combine them to multi-byte integral data
     types.
 
-    @param[in] vec  byte vector to read from
-    @param[in] current_index  the position in the vector after which to read
+    @param[in] vec  byte buffer to read from
+    @param[in] size  size of @a vec in bytes
+    @param[in] current_index  the position in the buffer after which to read
 
     @return the next sizeof(T) bytes from @a vec, in reverse order as T
 
     @tparam T the integral return type
 
     @throw std::out_of_range if there are less than sizeof(T)+1 bytes in the
-           vector @a vec to read
+           buffer @a vec to read
 
     In the for loop, the bytes from the vector are copied in reverse order into
     the return value. In the figures below, let sizeof(T)=4 and `i` be the loop
@@ -6623,11 +7643,11 @@ class basic_json
     @sa Code adapted from <http://stackoverflow.com/a/41031865/266378>.
     */
     template<typename T>
-    static T get_from_vector(const std::vector<uint8_t>& vec, const size_t current_index)
+    static T get_from_buffer(const uint8_t* vec, const size_t size, const size_t current_index)
     {
-        if (current_index + sizeof(T) + 1 > vec.size())
+        if (current_index + sizeof(T) + 1 > size)
         {
-            JSON_THROW(std::out_of_range("cannot read " + std::to_string(sizeof(T)) + " bytes from vector"));
+            JSON_THROW(std::out_of_range("cannot read " + std::to_string(sizeof(T)) + " bytes from buffer"));
         }
 
         T result;
@@ -7151,18 +8171,18 @@ class basic_json
 
 
     /*
-    @brief checks if given lengths do not exceed the size of a given vector
+    @brief checks if given lengths do not exceed the size of a given buffer
 
-    To secure the access to the byte vector during CBOR/MessagePack
-    deserialization, bytes are copied from the vector into buffers. This
-    function checks if the number of bytes to copy (@a len) does not exceed
-    the size @s size of the vector. Additionally, an @a offset is given from
-    where to start reading the bytes.
+    To secure the access to the byte buffer during CBOR/MessagePack
+    deserialization, every read is checked against the buffer size first.
+    This function checks if the number of bytes to read (@a len) does not
+    exceed the size @s size of the buffer. Additionally, an @a offset is given
+    from where to start reading the bytes.
 
     This function checks whether reading the bytes is safe; that is, offset is
-    a valid index in the vector, offset+len
+    a valid index in the buffer, offset+len
 
-    @param[in] size    size of the byte vector
+    @param[in] size    size of the byte buffer
     @param[in] len     number of bytes to read
     @param[in] offset  offset where to start reading
 
@@ -7170,7 +8190,7 @@ class basic_json
           ^         ^         ^
           0         offset    len
 
-    @throws out_of_range if `len > v.size()`
+    @throws out_of_range if `len > size`
     */
     static void check_length(const size_t size, const size_t len, const size_t offset)
     {
@@ -7193,663 +8213,627 @@ class basic_json
         }
     }
 
-    /*!
-    @brief create a JSON value from a given MessagePack vector
+    /// the byte at @a index of a buffer of @a size bytes (bounds checked)
+    static uint8_t byte_at(const uint8_t* v, const size_t size, const size_t index)
+    {
+        if (index >= size)
+        {
+            JSON_THROW(std::out_of_range("cannot read byte " + std::to_string(index) + " from buffer"));
+        }
+        return v[index];
+    }
 
-    @param[in] v  MessagePack serialization
-    @param[in] idx  byte index to start reading from @a v
+    /// the big-endian float or double after @a current_index
+    template<typename T>
+    static T get_float_from_buffer(const uint8_t* v, const size_t size, const size_t current_index)
+    {
+        check_length(size, sizeof(T), current_index + 1);
 
-    @return deserialized JSON value
+        // copy bytes in reverse order into the floating-point variable
+        T res;
+        for (size_t byte = 0; byte < sizeof(T); ++byte)
+        {
+            reinterpret_cast<uint8_t*>(&res)[sizeof(T) - byte - 1] = v[current_index + 1 + byte];
+        }
+        return res;
+    }
 
-    @throw std::invalid_argument if unsupported features from MessagePack were
-    used in the given vector @a v or if the input is not valid MessagePack
-    @throw std::out_of_range if the given vector ends prematurely
+    /// the @a len bytes at @a idx as characters; advances @a idx past them
+    static const char* take_string(const uint8_t* v, const size_t size, size_t& idx, const size_t len)
+    {
+        check_length(size, len, idx);
+        const char* s = reinterpret_cast<const char*>(v) + idx;
+        idx += len;
+        return s;
+    }
 
-    @sa https://github.com/msgpack/msgpack/blob/master/spec.md
+    /*!
+    @brief SAX visitor that builds a JSON value
+
+    Turns the events of the binary decoders into a DOM. Containers are
+    inserted into their parent when they start, and the visitor keeps
+    pointers to the open ones.
     */
-    static basic_json from_msgpack_internal(const std::vector<uint8_t>& v, size_t& idx)
+    class binary_dom_builder : public binary_sax
     {
-        // make sure reading 1 byte is safe
-        check_length(v.size(), 1, idx);
-
-        // store and increment index
-        const size_t current_idx = idx++;
+      public:
+        explicit binary_dom_builder(basic_json& r)
+            : root(r)
+        {}
 
-        if (v[current_idx] <= 0xbf)
+        void null()
         {
-            if (v[current_idx] <= 0x7f) // positive fixint
-            {
-                return v[current_idx];
-            }
-            if (v[current_idx] <= 0x8f) // fixmap
-            {
-                basic_json result = value_t::object;
-                const size_t len = v[current_idx] & 0x0f;
-                for (size_t i = 0; i < len; ++i)
-                {
-                    std::string key = from_msgpack_internal(v, idx);
-                    result[key] = from_msgpack_internal(v, idx);
-                }
-                return result;
-            }
-            else if (v[current_idx] <= 0x9f) // fixarray
-            {
-                basic_json result = value_t::array;
-                const size_t len = v[current_idx] & 0x0f;
-                for (size_t i = 0; i < len; ++i)
-                {
-                    result.push_back(from_msgpack_internal(v, idx));
-                }
-                return result;
-            }
-            else // fixstr
-            {
-                const size_t len = v[current_idx] & 0x1f;
-                const size_t offset = current_idx + 1;
-                idx += len; // skip content bytes
-                check_length(v.size(), len, offset);
-                return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
-            }
+            handle_value(basic_json(value_t::null));
         }
-        else if (v[current_idx] >= 0xe0) // negative fixint
+
+        void boolean(bool val)
         {
-            return static_cast<int8_t>(v[current_idx]);
+            handle_value(basic_json(val));
         }
-        else
-        {
-            switch (v[current_idx])
-            {
-                case 0xc0: // nil
-                {
-                    return value_t::null;
-                }
-
-                case 0xc2: // false
-                {
-                    return false;
-                }
-
-                case 0xc3: // true
-                {
-                    return true;
-                }
-
-                case 0xca: // float 32
-                {
-                    // copy bytes in reverse order into the double variable
-                    float res;
-                    for (size_t byte = 0; byte < sizeof(float); ++byte)
-                    {
-                        reinterpret_cast<uint8_t*>(&res)[sizeof(float) - byte - 1] = v.at(current_idx + 1 + byte);
-                    }
-                    idx += sizeof(float); // skip content bytes
-                    return res;
-                }
 
-                case 0xcb: // float 64
-                {
-                    // copy bytes in reverse order into the double variable
-                    double res;
-                    for (size_t byte = 0; byte < sizeof(double); ++byte)
-                    {
-                        reinterpret_cast<uint8_t*>(&res)[sizeof(double) - byte - 1] = v.at(current_idx + 1 + byte);
-                    }
-                    idx += sizeof(double); // skip content bytes
-                    return res;
-                }
+        void number_integer(number_integer_t val)
+        {
+            handle_value(basic_json(val));
+        }
 
-                case 0xcc: // uint 8
-                {
-                    idx += 1; // skip content byte
-                    return get_from_vector<uint8_t>(v, current_idx);
-                }
+        void number_unsigned(number_unsigned_t val)
+        {
+            handle_value(basic_json(val));
+        }
 
-                case 0xcd: // uint 16
-                {
-                    idx += 2; // skip 2 content bytes
-                    return get_from_vector<uint16_t>(v, current_idx);
-                }
+        void number_float(number_float_t val)
+        {
+            handle_value(basic_json(val));
+        }
 
-                case 0xce: // uint 32
-                {
-                    idx += 4; // skip 4 content bytes
-                    return get_from_vector<uint32_t>(v, current_idx);
-                }
+        void string(const char* s, size_t len)
+        {
+            handle_value(basic_json(string_t(s, len)));
+        }
 
-                case 0xcf: // uint 64
-                {
-                    idx += 8; // skip 8 content bytes
-                    return get_from_vector<uint64_t>(v, current_idx);
-                }
+        void start_object(size_t)
+        {
+            stack.push_back(handle_value(basic_json(value_t::object)));
+        }
 
-                case 0xd0: // int 8
-                {
-                    idx += 1; // skip content byte
-                    return get_from_vector<int8_t>(v, current_idx);
-                }
+        void key(const char* s, size_t len)
+        {
+            current_key.assign(s, len);
+        }
 
-                case 0xd1: // int 16
-                {
-                    idx += 2; // skip 2 content bytes
-                    return get_from_vector<int16_t>(v, current_idx);
-                }
+        void end_object()
+        {
+            stack.pop_back();
+        }
 
-                case 0xd2: // int 32
-                {
-                    idx += 4; // skip 4 content bytes
-                    return get_from_vector<int32_t>(v, current_idx);
-                }
+        void start_array(size_t)
+        {
+            stack.push_back(handle_value(basic_json(value_t::array)));
+        }
 
-                case 0xd3: // int 64
-                {
-                    idx += 8; // skip 8 content bytes
-                    return get_from_vector<int64_t>(v, current_idx);
-                }
+        void end_array()
+        {
+            stack.pop_back();
+        }
 
-                case 0xd9: // str 8
-                {
-                    const auto len = static_cast<size_t>(get_from_vector<uint8_t>(v, current_idx));
-                    const size_t offset = current_idx + 2;
-                    idx += len + 1; // skip size byte + content bytes
-                    check_length(v.size(), len, offset);
-                    return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
-                }
+      private:
+        /// store @a value in the innermost open container and return it
+        basic_json* handle_value(basic_json&& value)
+        {
+            if (stack.empty())
+            {
+                root = std::move(value);
+                return &root;
+            }
 
-                case 0xda: // str 16
-                {
-                    const auto len = static_cast<size_t>(get_from_vector<uint16_t>(v, current_idx));
-                    const size_t offset = current_idx + 3;
-                    idx += len + 2; // skip 2 size bytes + content bytes
-                    check_length(v.size(), len, offset);
-                    return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
-                }
+            basic_json& parent = *stack.back();
+            if (parent.is_array())
+            {
+                parent.m_value.array->push_back(std::move(value));
+                return &parent.m_value.array->back();
+            }
 
-                case 0xdb: // str 32
-                {
-                    const auto len = static_cast<size_t>(get_from_vector<uint32_t>(v, current_idx));
-                    const size_t offset = current_idx + 5;
-                    idx += len + 4; // skip 4 size bytes + content bytes
-                    check_length(v.size(), len, offset);
-                    return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
-                }
+            basic_json& member = parent[current_key];
+            member = std::move(value);
+            return &member;
+        }
 
-                case 0xdc: // array 16
-                {
-                    basic_json result = value_t::array;
-                    const auto len = static_cast<size_t>(get_from_vector<uint16_t>(v, current_idx));
-                    idx += 2; // skip 2 size bytes
-                    for (size_t i = 0; i < len; ++i)
-                    {
-                        result.push_back(from_msgpack_internal(v, idx));
-                    }
-                    return result;
-                }
+        /// the value being built
+        basic_json& root;
+        /// the open arrays and objects, innermost last
+        std::vector<basic_json*> stack;
+        /// the key of the next object member
+        typename object_t::key_type current_key;
+    };
 
-                case 0xdd: // array 32
-                {
-                    basic_json result = value_t::array;
-                    const auto len = static_cast<size_t>(get_from_vector<uint32_t>(v, current_idx));
-                    idx += 4; // skip 4 size bytes
-                    for (size_t i = 0; i < len; ++i)
-                    {
-                        result.push_back(from_msgpack_internal(v, idx));
-                    }
-                    return result;
-                }
+    /*!
+    @brief read the header of a MessagePack string
 
-                case 0xde: // map 16
-                {
-                    basic_json result = value_t::object;
-                    const auto len = static_cast<size_t>(get_from_vector<uint16_t>(v, current_idx));
-                    idx += 2; // skip 2 size bytes
-                    for (size_t i = 0; i < len; ++i)
-                    {
-                        std::string key = from_msgpack_internal(v, idx);
-                        result[key] = from_msgpack_internal(v, idx);
-                    }
-                    return result;
-                }
+    @param[in] v  MessagePack serialization
+    @param[in] size  size of @a v
+    @param[in,out] idx  index after the initial byte; advanced past the length
+    bytes
+    @param[in] b  the initial byte
+    @param[out] len  length of the string in bytes
 
-                case 0xdf: // map 32
-                {
-                    basic_json result = value_t::object;
-                    const auto len = static_cast<size_t>(get_from_vector<uint32_t>(v, current_idx));
-                    idx += 4; // skip 4 size bytes
-                    for (size_t i = 0; i < len; ++i)
-                    {
-                        std::string key = from_msgpack_internal(v, idx);
-                        result[key] = from_msgpack_internal(v, idx);
-                    }
-                    return result;
-                }
+    @return whether @a b starts a string
+    */
+    static bool msgpack_string_header(const uint8_t* v, const size_t size, size_t& idx,
+                                      const uint8_t b, size_t& len)
+    {
+        const size_t current_idx = idx - 1;
+        switch (b)
+        {
+            case 0xd9: // str 8
+            {
+                len = static_cast<size_t>(get_from_buffer<uint8_t>(v, size, current_idx));
+                idx += 1; // skip size byte
+                return true;
+            }
 
-                default:
-                {
-                    JSON_THROW(std::invalid_argument("error parsing a msgpack @ " + std::to_string(current_idx) + ": " + std::to_string(static_cast<int>(v[current_idx]))));
-                }
+            case 0xda: // str 16
+            {
+                len = static_cast<size_t>(get_from_buffer<uint16_t>(v, size, current_idx));
+                idx += 2; // skip 2 size bytes
+                return true;
+            }
+
+            case 0xdb: // str 32
+            {
+                len = static_cast<size_t>(get_from_buffer<uint32_t>(v, size, current_idx));
+                idx += 4; // skip 4 size bytes
+                return true;
+            }
+
+            default:
+            {
+                // fixstr
+                len = b & 0x1f;
+                return b >= 0xa0 and b <= 0xbf;
             }
         }
     }
 
     /*!
-    @brief create a JSON value from a given CBOR vector
+    @brief decode one MessagePack value and report it to a SAX visitor
 
-    @param[in] v  CBOR serialization
-    @param[in] idx  byte index to start reading from @a v
+    Strings are reported as pointers into @a v, so nothing is copied.
 
-    @return deserialized JSON value
+    @param[in] v  MessagePack serialization
+    @param[in] size  size of @a v
+    @param[in,out] idx  byte index to start reading from @a v; advanced past
+    the value
+    @param[in,out] sax  visitor receiving the events (see @ref binary_sax)
 
-    @throw std::invalid_argument if unsupported features from CBOR were used in
-    the given vector @a v or if the input is not valid CBOR
-    @throw std::out_of_range if the given vector ends prematurely
+    @throw std::invalid_argument if unsupported features from MessagePack were
+    used in the given buffer @a v or if the input is not valid MessagePack
+    @throw std::out_of_range if the given buffer ends prematurely
+    @throw std::domain_error if a map key is not a string
 
-    @sa https://tools.ietf.org/html/rfc7049
+    @sa https://github.com/msgpack/msgpack/blob/master/spec.md
     */
-    static basic_json from_cbor_internal(const std::vector<uint8_t>& v, size_t& idx)
+    template<typename SAX>
+    static void sax_msgpack_internal(const uint8_t* v, const size_t size, size_t& idx, SAX& sax)
     {
         // store and increment index
         const size_t current_idx = idx++;
+        const uint8_t b = byte_at(v, size, current_idx);
+
+        size_t len;
+        if (msgpack_string_header(v, size, idx, b, len))
+        {
+            const char* s = take_string(v, size, idx, len);
+            sax.string(s, len);
+            return;
+        }
+
+        if (b <= 0x7f) // positive fixint
+        {
+            sax.number_unsigned(b);
+            return;
+        }
+        if (b <= 0x8f) // fixmap
+        {
+            sax_msgpack_object(v, size, idx, b & 0x0f, sax);
+            return;
+        }
+        if (b <= 0x9f) // fixarray
+        {
+            sax_msgpack_array(v, size, idx, b & 0x0f, sax);
+            return;
+        }
+        if (b >= 0xe0) // negative fixint
+        {
+            sax.number_integer(static_cast<int8_t>(b));
+            return;
+        }
+
+        switch (b)
+        {
+            case 0xc0: // nil
+            {
+                sax.null();
+                return;
+            }
 
-        switch (v.at(current_idx))
-        {
-            // Integer 0x00..0x17 (0..23)
-            case 0x00:
-            case 0x01:
-            case 0x02:
-            case 0x03:
-            case 0x04:
-            case 0x05:
-            case 0x06:
-            case 0x07:
-            case 0x08:
-            case 0x09:
-            case 0x0a:
-            case 0x0b:
-            case 0x0c:
-            case 0x0d:
-            case 0x0e:
-            case 0x0f:
-            case 0x10:
-            case 0x11:
-            case 0x12:
-            case 0x13:
-            case 0x14:
-            case 0x15:
-            case 0x16:
-            case 0x17:
-            {
-                return v[current_idx];
-            }
-
-            case 0x18: // Unsigned integer (one-byte uint8_t follows)
+            case 0xc2: // false
+            {
+                sax.boolean(false);
+                return;
+            }
+
+            case 0xc3: // true
+            {
+                sax.boolean(true);
+                return;
+            }
+
+            case 0xca: // float 32
+            {
+                sax.number_float(get_float_from_buffer<float>(v, size, current_idx));
+                idx += sizeof(float); // skip content bytes
+                return;
+            }
+
+            case 0xcb: // float 64
+            {
+                sax.number_float(get_float_from_buffer<double>(v, size, current_idx));
+                idx += sizeof(double); // skip content bytes
+                return;
+            }
+
+            case 0xcc: // uint 8
             {
                 idx += 1; // skip content byte
-                return get_from_vector<uint8_t>(v, current_idx);
+                sax.number_unsigned(get_from_buffer<uint8_t>(v, size, current_idx));
+                return;
             }
 
-            case 0x19: // Unsigned integer (two-byte uint16_t follows)
+            case 0xcd: // uint 16
             {
                 idx += 2; // skip 2 content bytes
-                return get_from_vector<uint16_t>(v, current_idx);
+                sax.number_unsigned(get_from_buffer<uint16_t>(v, size, current_idx));
+                return;
             }
 
-            case 0x1a: // Unsigned integer (four-byte uint32_t follows)
+            case 0xce: // uint 32
             {
                 idx += 4; // skip 4 content bytes
-                return get_from_vector<uint32_t>(v, current_idx);
+                sax.number_unsigned(get_from_buffer<uint32_t>(v, size, current_idx));
+                return;
             }
 
-            case 0x1b: // Unsigned integer (eight-byte uint64_t follows)
+            case 0xcf: // uint 64
             {
                 idx += 8; // skip 8 content bytes
-                return get_from_vector<uint64_t>(v, current_idx);
-            }
-
-            // Negative integer -1-0x00..-1-0x17 (-1..-24)
-            case 0x20:
-            case 0x21:
-            case 0x22:
-            case 0x23:
-            case 0x24:
-            case 0x25:
-            case 0x26:
-            case 0x27:
-            case 0x28:
-            case 0x29:
-            case 0x2a:
-            case 0x2b:
-            case 0x2c:
-            case 0x2d:
-            case 0x2e:
-            case 0x2f:
-            case 0x30:
-            case 0x31:
-            case 0x32:
-            case 0x33:
-            case 0x34:
-            case 0x35:
-            case 0x36:
-            case 0x37:
-            {
-                return static_cast<int8_t>(0x20 - 1 - v[current_idx]);
-            }
-
-            case 0x38: // Negative integer (one-byte uint8_t follows)
+                sax.number_unsigned(get_from_buffer<uint64_t>(v, size, current_idx));
+                return;
+            }
+
+            case 0xd0: // int 8
             {
                 idx += 1; // skip content byte
-                // must be uint8_t !
-                return static_cast<number_integer_t>(-1) - get_from_vector<uint8_t>(v, current_idx);
+                sax.number_integer(get_from_buffer<int8_t>(v, size, current_idx));
+                return;
             }
 
-            case 0x39: // Negative integer -1-n (two-byte uint16_t follows)
+            case 0xd1: // int 16
             {
                 idx += 2; // skip 2 content bytes
-                return static_cast<number_integer_t>(-1) - get_from_vector<uint16_t>(v, current_idx);
+                sax.number_integer(get_from_buffer<int16_t>(v, size, current_idx));
+                return;
             }
 
-            case 0x3a: // Negative integer -1-n (four-byte uint32_t follows)
+            case 0xd2: // int 32
             {
                 idx += 4; // skip 4 content bytes
-                return static_cast<number_integer_t>(-1) - get_from_vector<uint32_t>(v, current_idx);
+                sax.number_integer(get_from_buffer<int32_t>(v, size, current_idx));
+                return;
             }
 
-            case 0x3b: // Negative integer -1-n (eight-byte uint64_t follows)
+            case 0xd3: // int 64
             {
                 idx += 8; // skip 8 content bytes
-                return static_cast<number_integer_t>(-1) - static_cast<number_integer_t>(get_from_vector<uint64_t>(v, current_idx));
+                sax.number_integer(get_from_buffer<int64_t>(v, size, current_idx));
+                return;
+            }
+
+            case 0xdc: // array 16
+            {
+                idx += 2; // skip 2 size bytes
+                sax_msgpack_array(v, size, idx, get_from_buffer<uint16_t>(v, size, current_idx), sax);
+                return;
             }
 
-            // UTF-8 string (0x00..0x17 bytes follow)
-            case 0x60:
-            case 0x61:
-            case 0x62:
-            case 0x63:
-            case 0x64:
-            case 0x65:
-            case 0x66:
-            case 0x67:
-            case 0x68:
-            case 0x69:
-            case 0x6a:
-            case 0x6b:
-            case 0x6c:
-            case 0x6d:
-            case 0x6e:
-            case 0x6f:
-            case 0x70:
-            case 0x71:
-            case 0x72:
-            case 0x73:
-            case 0x74:
-            case 0x75:
-            case 0x76:
-            case 0x77:
+            case 0xdd: // array 32
             {
-                const auto len = static_cast<size_t>(v[current_idx] - 0x60);
-                const size_t offset = current_idx + 1;
-                idx += len; // skip content bytes
-                check_length(v.size(), len, offset);
-                return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
+                idx += 4; // skip 4 size bytes
+                sax_msgpack_array(v, size, idx, get_from_buffer<uint32_t>(v, size, current_idx), sax);
+                return;
             }
 
-            case 0x78: // UTF-8 string (one-byte uint8_t for n follows)
+            case 0xde: // map 16
             {
-                const auto len = static_cast<size_t>(get_from_vector<uint8_t>(v, current_idx));
-                const size_t offset = current_idx + 2;
-                idx += len + 1; // skip size byte + content bytes
-                check_length(v.size(), len, offset);
-                return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
+                idx += 2; // skip 2 size bytes
+                sax_msgpack_object(v, size, idx, get_from_buffer<uint16_t>(v, size, current_idx), sax);
+                return;
             }
 
-            case 0x79: // UTF-8 string (two-byte uint16_t for n follow)
+            case 0xdf: // map 32
             {
-                const auto len = static_cast<size_t>(get_from_vector<uint16_t>(v, current_idx));
-                const size_t offset = current_idx + 3;
-                idx += len + 2; // skip 2 size bytes + content bytes
-                check_length(v.size(), len, offset);
-                return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
+                idx += 4; // skip 4 size bytes
+                sax_msgpack_object(v, size, idx, get_from_buffer<uint32_t>(v, size, current_idx), sax);
+                return;
             }
 
-            case 0x7a: // UTF-8 string (four-byte uint32_t for n follow)
+            default:
             {
-                const auto len = static_cast<size_t>(get_from_vector<uint32_t>(v, current_idx));
-                const size_t offset = current_idx + 5;
-                idx += len + 4; // skip 4 size bytes + content bytes
-                check_length(v.size(), len, offset);
-                return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
+                JSON_THROW(std::invalid_argument("error parsing a msgpack @ " + std::to_string(current_idx) + ": " + std::to_string(static_cast<int>(b))));
             }
+        }
+    }
+
+    /// decode the @a len elements of a MessagePack array
+    template<typename SAX>
+    static void sax_msgpack_array(const uint8_t* v, const size_t size, size_t& idx,
+                                  const size_t len, SAX& sax)
+    {
+        sax.start_array(len);
+        for (size_t i = 0; i < len; ++i)
+        {
+            sax_msgpack_internal(v, size, idx, sax);
+        }
+        sax.end_array();
+    }
 
-            case 0x7b: // UTF-8 string (eight-byte uint64_t for n follow)
+    /// decode the @a len key-value pairs of a MessagePack map
+    template<typename SAX>
+    static void sax_msgpack_object(const uint8_t* v, const size_t size, size_t& idx,
+                                   const size_t len, SAX& sax)
+    {
+        sax.start_object(len);
+        for (size_t i = 0; i < len; ++i)
+        {
+            const size_t key_idx = idx++;
+            size_t key_len;
+            if (not msgpack_string_header(v, size, idx, byte_at(v, size, key_idx), key_len))
             {
-                const auto len = static_cast<size_t>(get_from_vector<uint64_t>(v, current_idx));
-                const size_t offset = current_idx + 9;
-                idx += len + 8; // skip 8 size bytes + content bytes
-                check_length(v.size(), len, offset);
-                return std::string(reinterpret_cast<const char*>(v.data()) + offset, len);
+                JSON_THROW(std::domain_error("msgpack map key @ " + std::to_string(key_idx) + " is not a string"));
             }
+            const char* key = take_string(v, size, idx, key_len);
+            sax.key(key, key_len);
+            sax_msgpack_internal(v, size, idx, sax);
+        }
+        sax.end_object();
+    }
+
+    /*!
+    @brief read the argument of a CBOR data item
+
+    Decodes the additional information of the initial byte at
+    @a current_idx: either the value itself (0..23) or the number of bytes of
+    the big-endian argument that follows.
 
-            case 0x7f: // UTF-8 string (indefinite length)
+    @param[in,out] idx  index after the initial byte; advanced past the
+    argument bytes
+
+    @throw std::invalid_argument if the additional information is reserved
+    or indefinite
+    */
+    static uint64_t cbor_argument(const uint8_t* v, const size_t size, size_t& idx,
+                                  const size_t current_idx)
+    {
+        const uint8_t info = v[current_idx] & 0x1f;
+        switch (info)
+        {
+            case 0x18: // one-byte uint8_t follows
             {
-                std::string result;
-                while (v.at(idx) != 0xff)
-                {
-                    string_t s = from_cbor_internal(v, idx);
-                    result += s;
-                }
-                // skip break byte (0xFF)
                 idx += 1;
-                return result;
+                return get_from_buffer<uint8_t>(v, size, current_idx);
             }
 
-            // array (0x00..0x17 data items follow)
-            case 0x80:
-            case 0x81:
-            case 0x82:
-            case 0x83:
-            case 0x84:
-            case 0x85:
-            case 0x86:
-            case 0x87:
-            case 0x88:
-            case 0x89:
-            case 0x8a:
-            case 0x8b:
-            case 0x8c:
-            case 0x8d:
-            case 0x8e:
-            case 0x8f:
-            case 0x90:
-            case 0x91:
-            case 0x92:
-            case 0x93:
-            case 0x94:
-            case 0x95:
-            case 0x96:
-            case 0x97:
-            {
-                basic_json result = value_t::array;
-                const auto len = static_cast<size_t>(v[current_idx] - 0x80);
-                for (size_t i = 0; i < len; ++i)
-                {
-                    result.push_back(from_cbor_internal(v, idx));
-                }
-                return result;
+            case 0x19: // two-byte uint16_t follows
+            {
+                idx += 2;
+                return get_from_buffer<uint16_t>(v, size, current_idx);
             }
 
-            case 0x98: // array (one-byte uint8_t for n follows)
+            case 0x1a: // four-byte uint32_t follows
             {
-                basic_json result = value_t::array;
-                const auto len = static_cast<size_t>(get_from_vector<uint8_t>(v, current_idx));
-                idx += 1; // skip 1 size byte
-                for (size_t i = 0; i < len; ++i)
-                {
-                    result.push_back(from_cbor_internal(v, idx));
-                }
-                return result;
+                idx += 4;
+                return get_from_buffer<uint32_t>(v, size, current_idx);
             }
 
-            case 0x99: // array (two-byte uint16_t for n follow)
+            case 0x1b: // eight-byte uint64_t follows
             {
-                basic_json result = value_t::array;
-                const auto len = static_cast<size_t>(get_from_vector<uint16_t>(v, current_idx));
-                idx += 2; // skip 4 size bytes
-                for (size_t i = 0; i < len; ++i)
-                {
-                    result.push_back(from_cbor_internal(v, idx));
-                }
-                return result;
+                idx += 8;
+                return get_from_buffer<uint64_t>(v, size, current_idx);
             }
 
-            case 0x9a: // array (four-byte uint32_t for n follow)
+            default:
             {
-                basic_json result = value_t::array;
-                const auto len = static_cast<size_t>(get_from_vector<uint32_t>(v, current_idx));
-                idx += 4; // skip 4 size bytes
-                for (size_t i = 0; i < len; ++i)
+                if (info > 0x17)
                 {
-                    result.push_back(from_cbor_internal(v, idx));
+                    JSON_THROW(std::invalid_argument("error parsing a CBOR @ " + std::to_string(current_idx) + ": " + std::to_string(static_cast<int>(v[current_idx]))));
                 }
-                return result;
+                return info;
             }
+        }
+    }
 
-            case 0x9b: // array (eight-byte uint64_t for n follow)
+    /*!
+    @brief read a CBOR text string whose initial byte is at @a current_idx
+
+    Definite-length strings are returned as a pointer into @a v. The chunks
+    of an indefinite-length string are concatenated into @a chunks.
+
+    @param[out] s  first character of the string
+    @param[out] len  length of the string in bytes
+
+    @throw std::domain_error if the item or a chunk of it is not a text
+    string
+    */
+    static void cbor_text(const uint8_t* v, const size_t size, size_t& idx,
+                          const size_t current_idx, std::string& chunks,
+                          const char*& s, size_t& len)
+    {
+        const uint8_t b = byte_at(v, size, current_idx);
+        if ((b & 0xe0) != 0x60)
+        {
+            JSON_THROW(std::domain_error("CBOR item @ " + std::to_string(current_idx) + " is not a string"));
+        }
+
+        if (b != 0x7f)
+        {
+            len = static_cast<size_t>(cbor_argument(v, size, idx, current_idx));
+            s = take_string(v, size, idx, len);
+            return;
+        }
+
+        // indefinite length: definite-length chunks until the break byte
+        while (byte_at(v, size, idx) != 0xff)
+        {
+            const size_t chunk_idx = idx++;
+            if (v[chunk_idx] == 0x7f or (v[chunk_idx] & 0xe0) != 0x60)
             {
-                basic_json result = value_t::array;
-                const auto len = static_cast<size_t>(get_from_vector<uint64_t>(v, current_idx));
-                idx += 8; // skip 8 size bytes
-                for (size_t i = 0; i < len; ++i)
-                {
-                    result.push_back(from_cbor_internal(v, idx));
-                }
-                return result;
+                JSON_THROW(std::domain_error("CBOR string chunk @ " + std::to_string(chunk_idx) + " is not a string"));
             }
+            const size_t chunk_len = static_cast<size_t>(cbor_argument(v, size, idx, chunk_idx));
+            chunks.append(take_string(v, size, idx, chunk_len), chunk_len);
+        }
+        // skip break byte (0xFF)
+        idx += 1;
+        s = chunks.data();
+        len = chunks.size();
+    }
+
+    /*!
+    @brief decode one CBOR data item and report it to a SAX visitor
+
+    Definite-length strings are reported as pointers into @a v, so nothing
+    is copied. Indefinite-length arrays and maps are reported with the length
+    `std::string::npos`.
+
+    @param[in] v  CBOR serialization
+    @param[in] size  size of @a v
+    @param[in,out] idx  byte index to start reading from @a v; advanced past
+    the item
+    @param[in,out] sax  visitor receiving the events (see @ref binary_sax)
+
+    @throw std::invalid_argument if unsupported features from CBOR were used in
+    the given buffer @a v or if the input is not valid CBOR
+    @throw std::out_of_range if the given buffer ends prematurely
+    @throw std::domain_error if a map key is not a string
+
+    @sa https://tools.ietf.org/html/rfc7049
+    */
+    template<typename SAX>
+    static void sax_cbor_internal(const uint8_t* v, const size_t size, size_t& idx, SAX& sax)
+    {
+        // store and increment index
+        const size_t current_idx = idx++;
+        const uint8_t b = byte_at(v, size, current_idx);
 
-            case 0x9f: // array (indefinite length)
+        switch (b >> 5)
+        {
+            case 0: // unsigned integer
             {
-                basic_json result = value_t::array;
-                while (v.at(idx) != 0xff)
-                {
-                    result.push_back(from_cbor_internal(v, idx));
-                }
-                // skip break byte (0xFF)
-                idx += 1;
-                return result;
+                sax.number_unsigned(cbor_argument(v, size, idx, current_idx));
+                return;
             }
 
-            // map (0x00..0x17 pairs of data items follow)
-            case 0xa0:
-            case 0xa1:
-            case 0xa2:
-            case 0xa3:
-            case 0xa4:
-            case 0xa5:
-            case 0xa6:
-            case 0xa7:
-            case 0xa8:
-            case 0xa9:
-            case 0xaa:
-            case 0xab:
-            case 0xac:
-            case 0xad:
-            case 0xae:
-            case 0xaf:
-            case 0xb0:
-            case 0xb1:
-            case 0xb2:
-            case 0xb3:
-            case 0xb4:
-            case 0xb5:
-            case 0xb6:
-            case 0xb7:
-            {
-                basic_json result = value_t::object;
-                const auto len = static_cast<size_t>(v[current_idx] - 0xa0);
-                for (size_t i = 0; i < len; ++i)
-                {
-                    std::string key = from_cbor_internal(v, idx);
-                    result[key] = from_cbor_internal(v, idx);
-                }
-                return result;
+            case 1: // negative integer -1-n
+            {
+                const uint64_t n = cbor_argument(v, size, idx, current_idx);
+                sax.number_integer(static_cast<number_integer_t>(-1) - static_cast<number_integer_t>(n));
+                return;
             }
 
-            case 0xb8: // map (one-byte uint8_t for n follows)
+            case 3: // UTF-8 string
             {
-                basic_json result = value_t::object;
-                const auto len = static_cast<size_t>(get_from_vector<uint8_t>(v, current_idx));
-                idx += 1; // skip 1 size byte
-                for (size_t i = 0; i < len; ++i)
-                {
-                    std::string key = from_cbor_internal(v, idx);
-                    result[key] = from_cbor_internal(v, idx);
-                }
-                return result;
+                std::string chunks;
+                const char* s;
+                size_t len;
+                cbor_text(v, size, idx, current_idx, chunks, s, len);
+                sax.string(s, len);
+                return;
             }
 
-            case 0xb9: // map (two-byte uint16_t for n follow)
+            case 4: // array
             {
-                basic_json result = value_t::object;
-                const auto len = static_cast<size_t>(get_from_vector<uint16_t>(v, current_idx));
-                idx += 2; // skip 2 size bytes
-                for (size_t i = 0; i < len; ++i)
+                if (b == 0x9f) // indefinite length
                 {
-                    std::string key = from_cbor_internal(v, idx);
-                    result[key] = from_cbor_internal(v, idx);
+                    sax.start_array(std::string::npos);
+                    while (byte_at(v, size, idx) != 0xff)
+                    {
+                        sax_cbor_internal(v, size, idx, sax);
+                    }
+                    // skip break byte (0xFF)
+                    idx += 1;
+                    sax.end_array();
+                    return;
                 }
-                return result;
-            }
 
-            case 0xba: // map (four-byte uint32_t for n follow)
-            {
-                basic_json result = value_t::object;
-                const auto len = static_cast<size_t>(get_from_vector<uint32_t>(v, current_idx));
-                idx += 4; // skip 4 size bytes
+                const auto len = static_cast<size_t>(cbor_argument(v, size, idx, current_idx));
+                sax.start_array(len);
                 for (size_t i = 0; i < len; ++i)
                 {
-                    std::string key = from_cbor_internal(v, idx);
-                    result[key] = from_cbor_internal(v, idx);
+                    sax_cbor_internal(v, size, idx, sax);
                 }
-                return result;
+                sax.end_array();
+                return;
             }
 
-            case 0xbb: // map (eight-byte uint64_t for n follow)
+            case 5: // map
             {
-                basic_json result = value_t::object;
-                const auto len = static_cast<size_t>(get_from_vector<uint64_t>(v, current_idx));
-                idx += 8; // skip 8 size bytes
-                for (size_t i = 0; i < len; ++i)
+                const bool indefinite = (b == 0xbf);
+                const auto len = indefinite ? std::string::npos
+                                 : static_cast<size_t>(cbor_argument(v, size, idx, current_idx));
+                sax.start_object(len);
+                std::string chunks;
+                for (size_t i = 0; indefinite ? byte_at(v, size, idx) != 0xff : i < len; ++i)
                 {
-                    std::string key = from_cbor_internal(v, idx);
-                    result[key] = from_cbor_internal(v, idx);
+                    const size_t key_idx = idx++;
+                    const char* key;
+                    size_t key_len;
+                    chunks.clear();
+                    cbor_text(v, size, idx, key_idx, chunks, key, key_len);
+                    sax.key(key, key_len);
+                    sax_cbor_internal(v, size, idx, sax);
                 }
-                return result;
+                if (indefinite)
+                {
+                    // skip break byte (0xFF)
+                    idx += 1;
+                }
+                sax.end_object();
+                return;
             }
 
-            case 0xbf: // map (indefinite length)
+            default:
             {
-                basic_json result = value_t::object;
-                while (v.at(idx) != 0xff)
-                {
-                    std::string key = from_cbor_internal(v, idx);
-                    result[key] = from_cbor_internal(v, idx);
-                }
-                // skip break byte (0xFF)
-                idx += 1;
-                return result;
+                break;
             }
+        }
 
+        switch (b)
+        {
             case 0xf4: // false
             {
-                return false;
+                sax.boolean(false);
+                return;
             }
 
             case 0xf5: // true
             {
-                return true;
+                sax.boolean(true);
+                return;
             }
 
             case 0xf6: // null
             {
-                return value_t::null;
+                sax.null();
+                return;
             }
 
             case 0xf9: // Half-Precision Float (two-byte IEEE 754)
@@ -7863,7 +8847,7 @@ class basic_json
                 // include at least decoding support for them even without such
                 // support. An example of a small decoder for half-precision
                 // floating-point numbers in the C language is shown in Fig. 3.
-                const int half = (v.at(current_idx + 1) << 8) + v.at(current_idx + 2);
+                const int half = (byte_at(v, size, current_idx + 1) << 8) + byte_at(v, size, current_idx + 2);
                 const int exp = (half >> 10) & 0x1f;
                 const int mant = half & 0x3ff;
                 double val;
@@ -7881,36 +8865,27 @@ class basic_json
                           ? std::numeric_limits<double>::infinity()
                           : std::numeric_limits<double>::quiet_NaN();
                 }
-                return (half & 0x8000) != 0 ? -val : val;
+                sax.number_float((half & 0x8000) != 0 ? -val : val);
+                return;
             }
 
             case 0xfa: // Single-Precision Float (four-byte IEEE 754)
             {
-                // copy bytes in reverse order into the float variable
-                float res;
-                for (size_t byte = 0; byte < sizeof(float); ++byte)
-                {
-                    reinterpret_cast<uint8_t*>(&res)[sizeof(float) - byte - 1] = v.at(current_idx + 1 + byte);
-                }
+                sax.number_float(get_float_from_buffer<float>(v, size, current_idx));
                 idx += sizeof(float); // skip content bytes
-                return res;
+                return;
             }
 
             case 0xfb: // Double-Precision Float (eight-byte IEEE 754)
             {
-                // copy bytes in reverse order into the double variable
-                double res;
-                for (size_t byte = 0; byte < sizeof(double); ++byte)
-                {
-                    reinterpret_cast<uint8_t*>(&res)[sizeof(double) - byte - 1] = v.at(current_idx + 1 + byte);
-                }
+                sax.number_float(get_float_from_buffer<double>(v, size, current_idx));
                 idx += sizeof(double); // skip content bytes
-                return res;
+                return;
             }
 
-            default: // anything else (0xFF is handled inside the other types)
+            default: // byte strings, tags, and anything else
             {
-                JSON_THROW(std::invalid_argument("error parsing a CBOR @ " + std::to_string(current_idx) + ": " + std::to_string(static_cast<int>(v[current_idx]))));
+                JSON_THROW(std::invalid_argument("error parsing a CBOR @ " + std::to_string(current_idx) + ": " + std::to_string(static_cast<int>(b))));
             }
         }
     }
@@ -7969,13 +8944,67 @@ class basic_json
     @sa @ref from_cbor(const std::vector<uint8_t>&, const size_t) for the
         related CBOR format
 
-    @since version 2.0.9, parameter @a start_index since 2.1.1
+    @since version 2.0.9, parameter @a start_index since 2.1.1
+    */
+    static basic_json from_msgpack(const std::vector<uint8_t>& v,
+                                   const size_t start_index = 0)
+    {
+        return from_msgpack(v.data(), v.size(), start_index);
+    }
+
+    /*!
+    @brief create a JSON value from a buffer in MessagePack format
+
+    Same as @ref from_msgpack(const std::vector<uint8_t>&, const size_t), but
+    reads straight from memory such as a network receive buffer, so the
+    payload does not have to be copied into a vector first.
+
+    @param[in] data  MessagePack serialization
+    @param[in] size  number of bytes at @a data
+    @param[in] start_index the index to start reading from @a data
+
+    @return deserialized JSON value
+
+    @throw std::invalid_argument if unsupported features from MessagePack were
+    used in the given buffer or if the input is not valid MessagePack
+    @throw std::out_of_range if the given buffer ends prematurely
+    */
+    static basic_json from_msgpack(const uint8_t* data, const size_t size,
+                                   const size_t start_index = 0)
+    {
+        basic_json result;
+        binary_dom_builder builder(result);
+        size_t i = start_index;
+        sax_msgpack_internal(data, size, i, builder);
+        return result;
+    }
+
+    /*!
+    @brief decode a MessagePack value into a SAX visitor
+
+    Streams the value at the start of @a data to @a sax without building a
+    JSON value, e.g. to fill a typed struct. Strings are passed as pointers
+    into @a data.
+
+    @param[in] data  MessagePack serialization
+    @param[in] size  number of bytes at @a data
+    @param[in,out] sax  visitor with the interface of @ref binary_sax
+
+    @return number of bytes consumed
+
+    @throw std::invalid_argument if unsupported features from MessagePack were
+    used in the given buffer or if the input is not valid MessagePack
+    @throw std::out_of_range if the given buffer ends prematurely
+    @throw std::domain_error if a map key is not a string
+
+    @complexity Linear in @a size.
     */
-    static basic_json from_msgpack(const std::vector<uint8_t>& v,
-                                   const size_t start_index = 0)
+    template<typename SAX>
+    static size_t sax_parse_msgpack(const uint8_t* data, const size_t size, SAX& sax)
     {
-        size_t i = start_index;
-        return from_msgpack_internal(v, i);
+        size_t i = 0;
+        sax_msgpack_internal(data, size, i, sax);
+        return i;
     }
 
     /*!
@@ -8037,8 +9066,59 @@ class basic_json
     static basic_json from_cbor(const std::vector<uint8_t>& v,
                                 const size_t start_index = 0)
     {
+        return from_cbor(v.data(), v.size(), start_index);
+    }
+
+    /*!
+    @brief create a JSON value from a buffer in CBOR format
+
+    Same as @ref from_cbor(const std::vector<uint8_t>&, const size_t), but
+    reads straight from memory such as a network receive buffer.
+
+    @param[in] data  CBOR serialization
+    @param[in] size  number of bytes at @a data
+    @param[in] start_index the index to start reading from @a data
+
+    @return deserialized JSON value
+
+    @throw std::invalid_argument if unsupported features from CBOR were used in
+    the given buffer or if the input is not valid CBOR
+    @throw std::out_of_range if the given buffer ends prematurely
+    */
+    static basic_json from_cbor(const uint8_t* data, const size_t size,
+                                const size_t start_index = 0)
+    {
+        basic_json result;
+        binary_dom_builder builder(result);
         size_t i = start_index;
-        return from_cbor_internal(v, i);
+        sax_cbor_internal(data, size, i, builder);
+        return result;
+    }
+
+    /*!
+    @brief decode a CBOR data item into a SAX visitor
+
+    The CBOR counterpart of @ref sax_parse_msgpack.
+
+    @param[in] data  CBOR serialization
+    @param[in] size  number of bytes at @a data
+    @param[in,out] sax  visitor with the interface of @ref binary_sax
+
+    @return number of bytes consumed
+
+    @throw std::invalid_argument if unsupported features from CBOR were used in
+    the given buffer or if the input is not valid CBOR
+    @throw std::out_of_range if the given buffer ends prematurely
+    @throw std::domain_error if a map key is not a string
+
+    @complexity Linear in @a size.
+    */
+    template<typename SAX>
+    static size_t sax_parse_cbor(const uint8_t* data, const size_t size, SAX& sax)
+    {
+        size_t i = 0;
+        sax_cbor_internal(data, size, i, sax);
+        return i;
     }
 
     /// @}
@@ -8254,8 +9334,10 @@ class basic_json
     struct numtostr
     {
       public:
+        /// @a float_precision as for @ref dtoa::to_chars (doubles only)
         template<typename NumberType>
-        numtostr(NumberType value)
+        numtostr(NumberType value, int float_precision = 0)
+            : m_float_precision(float_precision)
         {
             x_write(value, std::is_integral<NumberType>());
         }
@@ -8269,6 +9351,9 @@ class basic_json
         /// a (hopefully) large enough character buffer
         std::array < char, 64 > m_buf{{}};
 
+        /// significant digits for doubles; 0 for shortest round-trip
+        const int m_float_precision;
+
         template<typename NumberType>
         void x_write(NumberType x, /*is_integral=*/std::true_type)
         {
@@ -8306,6 +9391,18 @@ class basic_json
         template<typename NumberType>
         void x_write(NumberType x, /*is_integral=*/std::false_type)
         {
+            // doubles: shortest round-trip digits (Grisu2), locale-independent
+            if (std::is_same<NumberType, double>::value)
+            {
+                if (not std::isfinite(x))
+                {
+                    std::memcpy(m_buf.data(), "null", 4);
+                    return;
+                }
+                *detail::dtoa::to_chars(m_buf.data(), static_cast<double>(x), m_float_precision) = '\0';
+                return;
+            }
+
             // special case for 0.0 and -0.0
             if (x == 0)
             {
@@ -8404,17 +9501,20 @@ class basic_json
     called recursively. Note that
 
     - strings and object keys are escaped using `escape_string()`
-    - integer numbers are converted implicitly via `operator<<`
-    - floating-point numbers are converted to a string using `"%g"` format
+    - numbers are converted with `numtostr`; floating-point numbers use the
+      shortest representation that reads back to the same value
 
-    @param[out] o              stream to write to
-    @param[in] pretty_print    whether the output shall be pretty-printed
-    @param[in] indent_step     the indent level
-    @param[in] current_indent  the current indent level (only used internally)
+    @param[out] o               buffer to append to
+    @param[in] pretty_print     whether the output shall be pretty-printed
+    @param[in] indent_step      the indent level
+    @param[in] float_precision  maximal significant digits of floating-point
+                                numbers; 0 for the shortest round-trip form
+    @param[in] current_indent   the current indent level (only used internally)
     */
-    void dump(std::ostream& o,
+    void dump(string_t& o,
               const bool pretty_print,
               const unsigned int indent_step,
+              const int float_precision,
               const unsigned int current_indent = 0) const
     {
         // variable to hold indentation for recursive calls
@@ -8426,39 +9526,41 @@ class basic_json
             {
                 if (m_value.object->empty())
                 {
-                    o << "{}";
+                    o += "{}";
                     return;
                 }
 
-                o << "{";
+                o += '{';
 
                 // increase indentation
                 if (pretty_print)
                 {
                     new_indent += indent_step;
-                    o << "\n";
+                    o += '\n';
                 }
 
                 for (auto i = m_value.object->cbegin(); i != m_value.object->cend(); ++i)
                 {
                     if (i != m_value.object->cbegin())
                     {
-                        o << (pretty_print ? ",\n" : ",");
+                        o += (pretty_print ? ",\n" : ",");
                     }
-                    o << string_t(new_indent, ' ') << "\""
-                      << escape_string(i->first) << "\":"
-                      << (pretty_print ? " " : "");
-                    i->second.dump(o, pretty_print, indent_step, new_indent);
+                    o.append(new_indent, ' ');
+                    o += '\"';
+                    o += escape_string(i->first);
+                    o += (pretty_print ? "\": " : "\":");
+                    i->second.dump(o, pretty_print, indent_step, float_precision, new_indent);
                 }
 
                 // decrease indentation
                 if (pretty_print)
                 {
                     new_indent -= indent_step;
-                    o << "\n";
+                    o += '\n';
                 }
 
-                o << string_t(new_indent, ' ') + "}";
+                o.append(new_indent, ' ');
+                o += '}';
                 return;
             }
 
@@ -8466,79 +9568,82 @@ class basic_json
             {
                 if (m_value.array->empty())
                 {
-                    o << "[]";
+                    o += "[]";
                     return;
                 }
 
-                o << "[";
+                o += '[';
 
                 // increase indentation
                 if (pretty_print)
                 {
                     new_indent += indent_step;
-                    o << "\n";
+                    o += '\n';
                 }
 
                 for (auto i = m_value.array->cbegin(); i != m_value.array->cend(); ++i)
                 {
                     if (i != m_value.array->cbegin())
                     {
-                        o << (pretty_print ? ",\n" : ",");
+                        o += (pretty_print ? ",\n" : ",");
                     }
-                    o << string_t(new_indent, ' ');
-                    i->dump(o, pretty_print, indent_step, new_indent);
+                    o.append(new_indent, ' ');
+                    i->dump(o, pretty_print, indent_step, float_precision, new_indent);
                 }
 
                 // decrease indentation
                 if (pretty_print)
                 {
                     new_indent -= indent_step;
-                    o << "\n";
+                    o += '\n';
                 }
 
-                o << string_t(new_indent, ' ') << "]";
+                o.append(new_indent, ' ');
+                o += ']';
                 return;
             }
 
             case value_t::string:
             {
-                o << string_t("\"") << escape_string(*m_value.string) << "\"";
+                o += '\"';
+                o += escape_string(*m_value.string);
+                o += '\"';
                 return;
             }
 
             case value_t::boolean:
             {
-                o << (m_value.boolean ? "true" : "false");
+                o += (m_value.boolean ? "true" : "false");
                 return;
             }
 
             case value_t::number_integer:
             {
-                o << numtostr(m_value.number_integer).c_str();
+                o += numtostr(m_value.number_integer).c_str();
                 return;
             }
 
             case value_t::number_unsigned:
             {
-                o << numtostr(m_value.number_unsigned).c_str();
+                o += numtostr(m_value.number_unsigned).c_str();
                 return;
             }
 
             case value_t::number_float:
             {
-                o << numtostr(m_value.number_float).c_str();
+                o += numtostr(m_value.number_float, float_precision).c_str();
                 return;
             }
 
             case value_t::discarded:
             {
-                o << "<discarded>";
+                o += "<discarded>";
                 return;
             }
 
             case value_t::null:
             {
-                o << "null";
+                o += "null";
                 return;
             }
         }
@@ -10973,10 +12078,23 @@ basic_json_parser_74:
         @throw std::out_of_range if to_unicode fails
         */
         string_t get_string() const
+        {
+            string_t result;
+            get_string(result);
+            return result;
+        }
+
+        /*!
+        @brief return string value for string tokens, reusing storage
+
+        Same as @ref get_string() const, but overwrites @a result so that its
+        capacity is reused across tokens.
+        */
+        void get_string(string_t& result) const
         {
             assert(m_cursor - m_start >= 2);
 
-            string_t result;
+            result.clear();
             result.reserve(static_cast<size_t>(m_cursor - m_start - 2));
 
             // iterate the result between the quotes
@@ -11083,8 +12201,6 @@ basic_json_parser_74:
                     }
                 }
             }
-
-            return result;
         }
 
 
@@ -11092,8 +12208,13 @@ basic_json_parser_74:
         @brief parse string into a built-in arithmetic type as if the current
                locale is POSIX.
 
-        @note in floating-point case strtod may parse past the token's end -
-              this is not an error
+        Integers and short decimal doubles (at most 19 significant digits and
+        a value that Clinger's fast path can compute exactly) are converted
+        here without touching the locale or reading past the token. All
+        other floating-point tokens fall back to the strtod family.
+
+        @note in floating-point fallback case strtod may parse past the
+              token's end - this is not an error
 
         @note any leading blanks are not handled
         */
@@ -11139,9 +12260,150 @@ basic_json_parser_74:
                 f = std::strtold(str, endptr);
             }
 
+            /*!
+            @brief exact, locale-independent conversion of short decimals
+
+            Splits the token into a decimal significand w and exponent q. If
+            w fits into the 53-bit mantissa and 10^q is exactly representable
+            (|q| <= 22), w * 10^q is a single correctly rounded operation on
+            exact operands, hence bit-identical to strtod (Clinger's fast
+            path). Significands small enough to absorb part of a larger
+            exponent exactly are handled the same way.
+
+            @return false if the token is outside that domain; @a value is
+                    then unspecified
+            */
+            bool parse_fast(double& value) const
+            {
+                static const double powers_of_ten[] =
+                {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                    1e20, 1e21, 1e22
+                };
+                const uint64_t max_mantissa = uint64_t(1) << 53;
+
+                // only valid when doubles are evaluated in double precision
+                if (not std::numeric_limits<double>::is_iec559 or FLT_EVAL_METHOD != 0)
+                {
+                    return false;
+                }
+
+                const char* p = m_start;
+                const bool negative = (p < m_end and *p == '-');
+                if (negative)
+                {
+                    ++p;
+                }
+
+                // significand, at most 19 significant digits
+                uint64_t w = 0;
+                int digits = 0;
+                int q = 0;
+                for (; p < m_end and *p >= '0' and * p <= '9'; ++p)
+                {
+                    if (w != 0 or *p != '0')
+                    {
+                        w = w * 10 + static_cast<uint64_t>(*p - '0');
+                        ++digits;
+                    }
+                }
+                if (p < m_end and *p == '.')
+                {
+                    for (++p; p < m_end and *p >= '0' and * p <= '9'; ++p)
+                    {
+                        if (w != 0 or *p != '0')
+                        {
+                            w = w * 10 + static_cast<uint64_t>(*p - '0');
+                            ++digits;
+                        }
+                        --q;
+                    }
+                }
+                if (digits > 19)
+                {
+                    return false;
+                }
+
+                // exponent
+                if (p < m_end and (*p == 'e' or * p == 'E'))
+                {
+                    ++p;
+                    bool exp_negative = false;
+                    if (p < m_end and (*p == '+' or * p == '-'))
+                    {
+                        exp_negative = (*p == '-');
+                        ++p;
+                    }
+                    int e = 0;
+                    for (; p < m_end and *p >= '0' and * p <= '9'; ++p)
+                    {
+                        if (e < 10000)
+                        {
+                            e = e * 10 + (*p - '0');
+                        }
+                    }
+                    q += exp_negative ? -e : e;
+                }
+
+                if (p != m_end)
+                {
+                    return false;
+                }
+
+                if (w == 0)
+                {
+                    value = negative ? -0.0 : 0.0;
+                    return true;
+                }
+
+                if (w > max_mantissa)
+                {
+                    return false;
+                }
+
+                // move excess powers of ten into w while it stays exact
+                while (q > 22 and w * 10 <= max_mantissa)
+                {
+                    w *= 10;
+                    --q;
+                }
+
+                if (q >= 0 and q <= 22)
+                {
+                    value = static_cast<double>(w) * powers_of_ten[q];
+                }
+                else if (q < 0 and q >= -22)
+                {
+                    value = static_cast<double>(w) / powers_of_ten[-q];
+                }
+                else
+                {
+                    return false;
+                }
+
+                if (negative)
+                {
+                    value = -value;
+                }
+                return true;
+            }
+
+            /// no fast path for float and long double
+            template<typename T>
+            bool parse_fast(T& /*unused*/) const
+            {
+                return false;
+            }
+
             template<typename T>
             bool parse(T& value, /*is_integral=*/std::false_type) const
             {
+                if (parse_fast(value))
+                {
+                    return true;
+                }
+
                 // replace decimal separator with locale-specific version,
                 // when necessary; data will point to either the original
                 // string, or buf, or tempstr containing the fixed string.
@@ -11204,36 +12466,51 @@ basic_json_parser_74:
                 return ok;
             }
 
-            // integral conversion
-
-            signed long long parse_integral(char** endptr, /*is_signed*/std::true_type) const
-            {
-                return std::strtoll(m_start, endptr, 10);
-            }
-
-            unsigned long long parse_integral(char** endptr, /*is_signed*/std::false_type) const
-            {
-                return std::strtoull(m_start, endptr, 10);
-            }
+            // integral conversion, locale-independent and bounded by the
+            // token
 
             template<typename T>
             bool parse(T& value, /*is_integral=*/std::true_type) const
             {
-                char* endptr = nullptr;
-                errno = 0; // these are thread-local
-                const auto x = parse_integral(&endptr, std::is_signed<T>());
+                const char* p = m_start;
+                const bool negative = (p < m_end and *p == '-');
+                if (negative)
+                {
+                    ++p;
+                }
+
+                // token was not empty
+                if (p == m_end)
+                {
+                    return false;
+                }
+
+                // negative values never fit into an unsigned type
+                if (negative and not std::is_signed<T>::value)
+                {
+                    return false;
+                }
 
-                // called right overload?
-                static_assert(std::is_signed<T>() == std::is_signed<decltype(x)>(), "");
+                // accumulate the magnitude, rejecting overflow
+                using unsigned_t = typename std::make_unsigned<T>::type;
+                const unsigned_t max_magnitude = negative
+                                                 ? static_cast<unsigned_t>(static_cast<unsigned_t>((std::numeric_limits<T>::max)()) + 1)
+                                                 : static_cast<unsigned_t>((std::numeric_limits<T>::max)());
 
-                value = static_cast<T>(x);
+                unsigned_t x = 0;
+                for (; p < m_end; ++p)
+                {
+                    const unsigned_t digit = static_cast<unsigned_t>(*p - '0');
+                    if (*p < '0' or * p > '9' or x > (max_magnitude - digit) / 10)
+                    {
+                        return false;
+                    }
+                    x = x * 10 + digit;
+                }
 
-                return (x == static_cast<decltype(x)>(value)) // x fits into destination T
-                       and (x < 0) == (value < 0)             // preserved sign
-                       //and ((x != 0) or is_integral())        // strto[u]ll did nto fail
-                       and (errno == 0)                       // strto[u]ll did not overflow
-                       and (m_start < m_end)                  // token was not empty
-                       and (endptr == m_end);                 // parsed entire token exactly
+                // negate in unsigned arithmetic, then convert (two's complement)
+                value = negative ? static_cast<T>(unsigned_t(0) - x) : static_cast<T>(x);
+                return true;
             }
         };
 
@@ -11391,6 +12668,18 @@ basic_json_parser_74:
             return result.is_discarded() ? basic_json() : std::move(result);
         }
 
+        /// parse into an existing value, reusing its storage
+        void parse_into(basic_json& result)
+        {
+            // read first token
+            get_token();
+
+            parse_internal_into(result);
+            result.assert_invariant();
+
+            expect(lexer::token_type::end_of_input);
+        }
+
       private:
         /// the actual parser
         basic_json parse_internal(bool keep)
@@ -11588,6 +12877,182 @@ basic_json_parser_74:
             return result;
         }
 
+        /*!
+        @brief the in-place parser
+
+        Parses the next value into @a result. Containers and strings that
+        already have the type of the parsed value are updated in place: array
+        elements and object members are parsed into recursively, so their
+        storage (and that of strings below them) is kept. Scalars are simply
+        overwritten. Wherever the type differs, the value is rebuilt with
+        @ref parse_internal. Callbacks are not supported.
+        */
+        void parse_internal_into(basic_json& result)
+        {
+            switch (last_token)
+            {
+                case lexer::token_type::begin_object:
+                {
+                    // members are tracked by position in a 64 bit mask, so
+                    // larger objects are rebuilt
+                    if (not result.is_object() or result.m_value.object->size() > 64)
+                    {
+                        result = parse_internal(true);
+                        return;
+                    }
+
+                    object_t& object = *result.m_value.object;
+                    const std::size_t old_size = object.size();
+                    std::uint64_t seen = 0;
+
+                    // new members are added after the pass so positions stay
+                    // valid for the mask (flat_map shifts on insert)
+                    std::vector<std::pair<string_t, basic_json>> added;
+
+                    get_token();
+                    if (last_token != lexer::token_type::end_object)
+                    {
+                        // no comma is expected here
+                        unexpect(lexer::token_type::value_separator);
+
+                        string_t key;
+                        do
+                        {
+                            if (last_token == lexer::token_type::value_separator)
+                            {
+                                get_token();
+                            }
+
+                            // store key
+                            expect(lexer::token_type::value_string);
+                            m_lexer.get_string(key);
+
+                            // parse separator (:)
+                            get_token();
+                            expect(lexer::token_type::name_separator);
+
+                            // parse value into the existing member, if any
+                            get_token();
+                            auto it = object.find(key);
+                            if (it != object.end())
+                            {
+                                seen |= std::uint64_t(1) << std::distance(object.begin(), it);
+                                parse_internal_into(it->second);
+                            }
+                            else
+                            {
+                                added.emplace_back(key, parse_internal(true));
+                            }
+                        }
+                        while (last_token == lexer::token_type::value_separator);
+
+                        // closing }
+                        expect(lexer::token_type::end_object);
+                    }
+                    get_token();
+
+                    // drop members missing from the input, back to front so
+                    // the remaining positions match the mask
+                    for (std::size_t i = old_size; i-- > 0;)
+                    {
+                        if (not (seen & (std::uint64_t(1) << i)))
+                        {
+                            object.erase(std::next(object.begin(), static_cast<std::ptrdiff_t>(i)));
+                        }
+                    }
+
+                    for (auto& member : added)
+                    {
+                        object[member.first] = std::move(member.second);
+                    }
+                    return;
+                }
+
+                case lexer::token_type::begin_array:
+                {
+                    if (not result.is_array())
+                    {
+                        result = parse_internal(true);
+                        return;
+                    }
+
+                    array_t& array = *result.m_value.array;
+                    std::size_t count = 0;
+
+                    get_token();
+                    if (last_token != lexer::token_type::end_array)
+                    {
+                        // no comma is expected here
+                        unexpect(lexer::token_type::value_separator);
+
+                        do
+                        {
+                            if (last_token == lexer::token_type::value_separator)
+                            {
+                                get_token();
+                            }
+
+                            // parse into the existing element or append
+                            if (count < array.size())
+                            {
+                                parse_internal_into(array[count]);
+                            }
+                            else
+                            {
+                                array.push_back(parse_internal(true));
+                            }
+                            ++count;
+                        }
+                        while (last_token == lexer::token_type::value_separator);
+
+                        // closing ]
+                        expect(lexer::token_type::end_array);
+                    }
+                    get_token();
+
+                    // drop surplus elements (keeps the capacity)
+                    if (count < array.size())
+                    {
+                        array.erase(array.begin() + static_cast<std::ptrdiff_t>(count), array.end());
+                    }
+                    return;
+                }
+
+                case lexer::token_type::value_string:
+                {
+                    if (result.is_string())
+                    {
+                        m_lexer.get_string(*result.m_value.string);
+                        get_token();
+                        return;
+                    }
+                    break;
+                }
+
+                case lexer::token_type::value_unsigned:
+                case lexer::token_type::value_integer:
+                case lexer::token_type::value_float:
+                {
+                    if (result.is_number() or result.is_boolean() or result.is_null())
+                    {
+                        // no storage to release, so overwrite directly
+                        m_lexer.get_number(result, last_token);
+                        get_token();
+                        return;
+                    }
+                    break;
+                }
+
+                default:
+                {
+                    break;
+                }
+            }
+
+            // scalars and type mismatches: build a fresh value
+            result = parse_internal(true);
+        }
+
         /// get next token from lexer
         typename lexer::token_type get_token()
         {
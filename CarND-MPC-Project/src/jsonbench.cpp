@@ -0,0 +1,144 @@
+// Benchmark of json.hpp on simulator telemetry: parses a recorded frame and
+// looks up its members with std::map and flat_map objects, converts its
+// numbers with the lexer against strtod, and decodes the frame from
+// MessagePack into a value and through a visitor.
+//
+//   jsonbench [iterations]
+//
+// Each figure is the best of kRuns runs of the given number of iterations,
+// in nanoseconds per iteration.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+using std::chrono::steady_clock;
+
+using map_json = nlohmann::basic_json<std::map>;
+using flat_json = nlohmann::basic_json<nlohmann::flat_map>;
+
+// The data object of a "telemetry" event as the simulator sends it
+const char kTelemetry[] =
+    "[\"telemetry\",{\"ptsx\":[-32.16173,-43.49173,-61.09,-78.29172,"
+    "-93.05002,-107.7717],\"ptsy\":[113.361,105.941,92.88499,78.73102,"
+    "65.34102,50.57938],\"psi_unity\":4.12033,\"psi\":3.733651,"
+    "\"x\":-40.62,\"y\":108.73,\"steering_angle\":0,\"throttle\":0,"
+    "\"speed\":0.4380091}]";
+
+const int kRuns = 7;
+
+// Keeps the optimizer from discarding the work measured
+static volatile double sink;
+
+// Best time of kRuns runs of f over the iterations, per iteration (ns).
+template <class F>
+static double Time(long iterations, F f) {
+  double best = 1e300;
+  for (int run = 0; run < kRuns; ++run) {
+    const steady_clock::time_point start = steady_clock::now();
+    for (long i = 0; i < iterations; ++i) f();
+    const std::chrono::duration<double, std::nano> elapsed =
+        steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / iterations);
+  }
+  return best;
+}
+
+template <class Json>
+static void Report(const char* name, long iterations) {
+  const Json frame = Json::parse(kTelemetry);
+  const double parse = Time(iterations, [] {
+    sink = Json::parse(kTelemetry)[1]["speed"].template get<double>();
+  });
+  const double lookup = Time(iterations, [&frame] {
+    const Json& data = frame[1];
+    sink = data["x"].template get<double>() +
+           data["y"].template get<double>() +
+           data["psi"].template get<double>() +
+           data["speed"].template get<double>() +
+           data["steering_angle"].template get<double>() +
+           data["throttle"].template get<double>();
+  });
+  const double copy = Time(iterations, [&frame] {
+    Json copy = frame;
+    sink = copy.size();
+  });
+  std::cout << name << ": parse " << parse << " ns, 6 lookups " << lookup
+            << " ns, copy " << copy << " ns" << std::endl;
+}
+
+// The numbers of the frame, as an array parsed by json.hpp and one by one
+// by strtod, per number.
+static void ReportNumbers(long iterations) {
+  std::vector<std::string> tokens;
+  const flat_json frame = flat_json::parse(kTelemetry);
+  for (const char* key : {"ptsx", "ptsy"}) {
+    for (const flat_json& x : frame[1][key]) tokens.push_back(x.dump());
+  }
+  std::string array = "[";
+  for (const std::string& token : tokens) {
+    array += (array.size() > 1 ? "," : "") + token;
+  }
+  array += "]";
+
+  const double n = tokens.size();
+  flat_json parsed;
+  const double lexer = Time(iterations, [&array, &parsed] {
+    flat_json::parse_into(parsed, array);
+    sink = parsed[0].get<double>();
+  });
+  const double libc = Time(iterations, [&tokens] {
+    double sum = 0;
+    for (const std::string& token : tokens) {
+      sum += std::strtod(token.c_str(), nullptr);
+    }
+    sink = sum;
+  });
+  std::cout << "numbers: json.hpp " << lexer / n << " ns, strtod "
+            << libc / n << " ns" << std::endl;
+}
+
+// Picks the speed out of a telemetry frame without building a value.
+struct SpeedVisitor : flat_json::binary_sax {
+  bool next = false;
+  double speed = 0;
+
+  void key(const char* s, size_t len) {
+    next = std::string(s, len) == "speed";
+  }
+  void number_float(double x) {
+    if (next) speed = x;
+  }
+};
+
+// The frame as MessagePack, decoded from the receive buffer into a value
+// and by a visitor that only reads the speed.
+static void ReportBinary(long iterations) {
+  const std::vector<uint8_t> msgpack =
+      flat_json::to_msgpack(flat_json::parse(kTelemetry));
+  const double value = Time(iterations, [&msgpack] {
+    sink = flat_json::from_msgpack(msgpack.data(), msgpack.size())[1]["speed"]
+               .get<double>();
+  });
+  const double visitor = Time(iterations, [&msgpack] {
+    SpeedVisitor speed;
+    flat_json::sax_parse_msgpack(msgpack.data(), msgpack.size(), speed);
+    sink = speed.speed;
+  });
+  std::cout << "msgpack " << msgpack.size() << " bytes: value " << value
+            << " ns, visitor " << visitor << " ns" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const long iterations = argc > 1 ? atol(argv[1]) : 100000;
+  Report<map_json>("std::map", iterations);
+  Report<flat_json>("flat_map", iterations);
+  ReportNumbers(iterations);
+  ReportBinary(iterations);
+  return 0;
+}
@@ -0,0 +1,246 @@
+// Load generator for the controller: plays a simulator driving along a
+// synthetic road and reports round-trip times and bytes per frame.
+//
+//   loadgen [json|binary] [frames] [url]
+//   loadgen shm [frames] [vehicle]
+//   loadgen udp [frames] [port]
+//
+// "json" speaks the simulator's Socket.IO text protocol, "binary" negotiates
+// the wire format of wire.h, "shm" attaches to the shared-memory channel
+// of a controller started with --shm, and "udp" sends datagrams to a
+// controller started with --udp. Note that the controller holds every
+// reply back by its simulated actuation latency, which is included in the
+// round trip.
+#include <math.h>
+#include <uWS/uWS.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "shm_channel.h"
+#include "telemetry.h"
+#include "udp_channel.h"
+#include "wire.h"
+
+using std::chrono::steady_clock;
+
+// The road: y = kAmplitude * sin(x / kWavelength), sampled every kSpacing
+// meters ahead of the car.
+const double kAmplitude = 20.0;
+const double kWavelength = 80.0;
+const double kSpacing = 12.0;
+const int kWaypoints = 6;
+const double kSpeed = 40.0;     // mph
+const double kFramePeriod = 0.1;  // simulated seconds between frames
+
+// Telemetry of frame k: the car follows the road exactly.
+static void MakeTelemetry(int k, Telemetry* t) {
+  const double s = kSpeed * 0.44704 * kFramePeriod * k;
+  t->x = s;
+  t->y = kAmplitude * sin(s / kWavelength);
+  t->psi = atan(kAmplitude / kWavelength * cos(s / kWavelength));
+  t->speed = kSpeed;
+  t->steering_angle = 0;
+  t->throttle = 0;
+  // Waypoints are resent unchanged until the car passes the first one
+  const double first = floor(s / kSpacing) * kSpacing;
+  t->n = kWaypoints;
+  for (int i = 0; i < kWaypoints; ++i) {
+    t->ptsx[i] = first + kSpacing * i;
+    t->ptsy[i] = kAmplitude * sin(t->ptsx[i] / kWavelength);
+  }
+}
+
+// The same frame as a Socket.IO "telemetry" event.
+static std::string TelemetryEvent(const Telemetry& t) {
+  std::ostringstream os;
+  os.precision(10);
+  os << "42[\"telemetry\",{\"ptsx\":[";
+  for (int i = 0; i < t.n; ++i) os << (i ? "," : "") << t.ptsx[i];
+  os << "],\"ptsy\":[";
+  for (int i = 0; i < t.n; ++i) os << (i ? "," : "") << t.ptsy[i];
+  os << "],\"psi\":" << t.psi << ",\"speed\":" << t.speed
+     << ",\"steering_angle\":" << t.steering_angle
+     << ",\"throttle\":" << t.throttle << ",\"x\":" << t.x
+     << ",\"y\":" << t.y << "}]";
+  return os.str();
+}
+
+// Print round-trip statistics of a run.
+static void Report(const char* mode, std::vector<double>& rtt_us,
+                   size_t bytes_out, size_t bytes_in) {
+  if (rtt_us.empty()) return;
+  std::sort(rtt_us.begin(), rtt_us.end());
+  double sum = 0;
+  for (double r : rtt_us) sum += r;
+  const size_t n = rtt_us.size();
+  std::cout << mode << ": " << n << " frames"
+            << ", rtt mean " << sum / n << " us"
+            << ", p50 " << rtt_us[n / 2] << " us"
+            << ", p99 " << rtt_us[std::min(n - 1, n * 99 / 100)] << " us"
+            << ", " << double(bytes_out) / n << " B out"
+            << ", " << double(bytes_in) / n << " B in per frame"
+            << std::endl;
+}
+
+// Drive the controller over its shared-memory channel.
+static int RunSharedMemory(int frames, int vehicle) {
+  ShmChannel channel;
+  if (!channel.Attach(vehicle)) {
+    std::cerr << "Failed to attach to vehicle " << vehicle << std::endl;
+    return 1;
+  }
+  std::vector<double> rtt_us;
+  Telemetry t;
+  Actuation a;
+  for (int k = 0; k < frames; ++k) {
+    MakeTelemetry(k, &t);
+    const steady_clock::time_point t_sent = steady_clock::now();
+    if (!channel.SendTelemetry(t)) {
+      std::cerr << "Telemetry ring full" << std::endl;
+      return 1;
+    }
+    if (!channel.ReceiveActuation(&a, 5000)) {
+      std::cerr << "No reply" << std::endl;
+      return 1;
+    }
+    rtt_us.push_back(std::chrono::duration<double, std::micro>(
+        steady_clock::now() - t_sent).count());
+  }
+  Report("shm", rtt_us, sizeof(Telemetry) * frames, sizeof(Actuation) * frames);
+  return 0;
+}
+
+// Drive the controller over UDP on the loopback interface. A reply that
+// does not arrive in time counts as lost; late replies are dropped.
+static int RunUdp(int frames, int port) {
+  UdpChannel channel;
+  if (!channel.Connect("127.0.0.1", port)) {
+    std::cerr << "Failed to connect to UDP port " << port << std::endl;
+    return 1;
+  }
+  std::vector<double> rtt_us;
+  int lost = 0;
+  size_t bytes_out = 0;
+  size_t bytes_in = 0;
+  uint8_t frame[wire::kMaxFrameSize];
+  Telemetry t;
+  Actuation a;
+  for (int k = 0; k < frames; ++k) {
+    MakeTelemetry(k, &t);
+    const uint64_t seq = uint64_t(k) + 1;
+    const steady_clock::time_point t_sent = steady_clock::now();
+    channel.SendTelemetry(seq, t);
+    uint64_t echoed = 0;
+    while (echoed < seq && channel.ReceiveActuation(&a, &echoed, 1000)) {
+    }
+    if (echoed != seq) {
+      lost++;
+      continue;
+    }
+    rtt_us.push_back(std::chrono::duration<double, std::micro>(
+        steady_clock::now() - t_sent).count());
+    bytes_out += wire::kSequenceSize + wire::EncodeTelemetry(t, frame);
+    bytes_in += wire::kSequenceSize + wire::EncodeActuation(a, frame);
+  }
+  Report("udp", rtt_us, bytes_out, bytes_in);
+  std::cout << "udp: " << lost << " replies lost, "
+            << channel.stats().stale << " stale" << std::endl;
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  const int frames = argc > 2 ? atoi(argv[2]) : 200;
+  if (argc > 1 && strcmp(argv[1], "shm") == 0) {
+    return RunSharedMemory(frames, argc > 3 ? atoi(argv[3]) : 0);
+  }
+  if (argc > 1 && strcmp(argv[1], "udp") == 0) {
+    return RunUdp(frames, argc > 3 ? atoi(argv[3]) : 4568);
+  }
+
+  const bool binary = argc > 1 && strcmp(argv[1], "binary") == 0;
+  const std::string url = argc > 3 ? argv[3] : "ws://127.0.0.1:4567";
+
+  uWS::Hub h;
+
+  int sent = 0;
+  size_t bytes_out = 0;
+  size_t bytes_in = 0;
+  std::vector<double> rtt_us;
+  steady_clock::time_point t_sent;
+  uint8_t frame[wire::kMaxFrameSize];
+  std::string text;
+
+  auto send_next = [&](uWS::WebSocket<uWS::CLIENT> ws) {
+    Telemetry t;
+    MakeTelemetry(sent++, &t);
+    t_sent = steady_clock::now();
+    if (binary) {
+      size_t n = wire::EncodeTelemetry(t, frame);
+      bytes_out += n;
+      ws.send(reinterpret_cast<const char*>(frame), n, uWS::OpCode::BINARY);
+    } else {
+      text = TelemetryEvent(t);
+      bytes_out += text.size();
+      ws.send(text.data(), text.size(), uWS::OpCode::TEXT);
+    }
+  };
+
+  h.onConnection([&](uWS::WebSocket<uWS::CLIENT> ws, uWS::HttpRequest req) {
+    if (binary) {
+      size_t n = wire::EncodeHello(wire::kVersion, frame);
+      ws.send(reinterpret_cast<const char*>(frame), n, uWS::OpCode::BINARY);
+    } else {
+      send_next(ws);
+    }
+  });
+
+  h.onMessage([&](uWS::WebSocket<uWS::CLIENT> ws, char* data, size_t length,
+                  uWS::OpCode opCode) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+    if (binary && wire::PeekType(in, length) == wire::kHello) {
+      uint16_t version;
+      if (!wire::DecodeHello(in, length, &version) || version != wire::kVersion) {
+        std::cerr << "Version negotiation failed" << std::endl;
+        ws.close();
+        return;
+      }
+      send_next(ws);
+      return;
+    }
+
+    rtt_us.push_back(std::chrono::duration<double, std::micro>(
+        steady_clock::now() - t_sent).count());
+    bytes_in += length;
+    if (binary) {
+      Actuation a;
+      if (!wire::DecodeActuation(in, length, &a)) {
+        std::cerr << "Bad actuation frame" << std::endl;
+      }
+    }
+
+    if (sent < frames) {
+      send_next(ws);
+    } else {
+      ws.close();
+    }
+  });
+
+  h.onError([](void*) {
+    std::cerr << "Failed to connect" << std::endl;
+    exit(1);
+  });
+
+  h.onDisconnection([&](uWS::WebSocket<uWS::CLIENT> ws, int code,
+                        char* message, size_t length) {
+    Report(binary ? "binary" : "json", rtt_us, bytes_out, bytes_in);
+  });
+
+  h.connect(url, nullptr);
+  h.run();
+}
@@ -1,224 +1,680 @@
 #include <math.h>
+#include <algorithm>
 #include <uWS/uWS.h>
+#include <uv.h>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <thread>
 #include <vector>
-#include "Eigen-3.3/Eigen/Core"
-#include "Eigen-3.3/Eigen/QR"
-#include "MPC.h"
+#include "controller.h"
 #include "json.hpp"
-
-// for convenience
-using json = nlohmann::json;
+#include "plan_service.h"
+#include "plan_tracker.h"
+#include "pure_pursuit.h"
+#include "shm_channel.h"
+#include "socketio.h"
+#include "solver_pool.h"
+#include "telemetry.h"
+#include "udp_channel.h"
+#include "wire.h"
+#include "worker_thread.h"
+
+// for convenience; telemetry objects are small, so store them flat
+using json = nlohmann::basic_json<nlohmann::flat_map>;
 
 // For converting back and forth between radians and degrees.
 constexpr double pi() { return M_PI; }
 double deg2rad(double x) { return x * pi() / 180; }
 double rad2deg(double x) { return x * 180 / pi(); }
 
-// Checks if the SocketIO event has JSON data.
-// If there is data the JSON object in string format will be returned,
-// else the empty string "" will be returned.
-string hasData(string s) {
-  auto found_null = s.find("null");
-  auto b1 = s.find_first_of("[");
-  auto b2 = s.rfind("}]");
-  if (found_null != string::npos) {
-    return "";
-  } else if (b1 != string::npos && b2 != string::npos) {
-    return s.substr(b1, b2 - b1 + 2);
-  }
-  return "";
+// Significant digits of the visualization points sent to the simulator.
+const int kVizPrecision = 5;
+
+// Visualization sent with every so many replies by default; 0 sends it
+// whenever a point of it moved by more than kVizTolerance (m).
+const int kDefaultVizInterval = 1;
+const double kVizTolerance = 0.1;
+
+// Batch planning (see plan_service.h): batches open at a time, and the
+// largest request body accepted (bytes).
+const int kMaxPlanBatches = 4;
+const size_t kMaxPlanBody = 32 << 20;
+
+// Overload protection. At most this many solves are queued by default; the
+// limit of a priority class is halved for each class below the highest.
+// Past half its limit a frame is solved over the shorter kDegradedHorizon,
+// past its limit it is shed.
+const int kDefaultQueueLimit = 8;
+const int kDegradedHorizon = 8;
+
+// Connection priority classes, highest first.
+enum Priority { kHighPriority, kNormalPriority, kLowPriority, kPriorities };
+
+// Two-rate control (see plan_tracker.h) is off by default: every frame is
+// answered by a solve.
+const double kDefaultReplanInterval = 0;
+
+// Report the overload counters every so many telemetry frames.
+const int kOverloadReportInterval = 500;
+
+struct Job;
+
+// Per-connection state, kept in the socket's user data. Only the event
+// loop touches it, except for the controller.
+struct Connection {
+  uWS::WebSocket<uWS::SERVER> ws;
+  // Negotiated the binary wire format (see wire.h)
+  bool binary;
+  // Disconnected; freed once the solver has handed back all its frames
+  bool closed;
+  // Telemetry frames of this connection at the solver
+  int pending;
+  // Reply buffer, reused
+  std::string out;
+  // Replies sent so far
+  int replies;
+  // Visualization last sent, with a viz interval of 0
+  Actuation viz_sent;
+  // Priority class, from the query of the websocket URL
+  int priority;
+  // Latest frame at the solver, which a newer frame may take the place of
+  // until it is started
+  Job* queued;
+  // The MPC's last plan, tracked between solves
+  TrackedPlan plan;
+  // Drives this connection's car alone, so that its latency estimate,
+  // speculative solve and warm start follow only its own frames. Only the
+  // solver thread runs it; the event loop reads its constant actuator
+  // delay.
+  Controller controller;
+};
+
+// A telemetry frame on its way through the solver thread.
+struct Job {
+  Connection* conn;
+  // Reply in the binary wire format rather than as a Socket.IO event
+  bool binary;
+  Telemetry telemetry;
+  Actuation actuation;
+  // MPC horizon to solve over, 0 for the default one
+  int horizon;
+  std::chrono::steady_clock::time_point arrived;
+  // Answered by tracking already, solved only for a new plan
+  bool answered;
+  TrackedPlan plan;
+};
+
+// Telemetry frames received, answered by tracking the MPC's plan, and
+// those that took the place of a queued one, were solved over a shorter
+// horizon or did not get a solve.
+struct OverloadStats {
+  long received;
+  long tracked;
+  long coalesced;
+  long degraded;
+  long shed;
+};
+
+// Fill a telemetry frame from the data object of a "telemetry" event.
+// Returns false unless it has as many ptsx as ptsy, enough of them to fit
+// the reference path and no more than a frame holds, as the binary decoder
+// does.
+bool ReadTelemetry(json& data, Telemetry* t) {
+  t->x = data["x"];
+  t->y = data["y"];
+  t->psi = data["psi"];
+  t->speed = data["speed"];
+  t->steering_angle = data["steering_angle"];
+  t->throttle = data["throttle"];
+
+  json& ptsx = data["ptsx"];
+  json& ptsy = data["ptsy"];
+  if (!ptsx.is_array() || !ptsy.is_array() || ptsx.size() != ptsy.size() ||
+      ptsx.size() < size_t(Telemetry::kMinWaypoints) ||
+      ptsx.size() > size_t(Telemetry::kMaxWaypoints)) {
+    return false;
+  }
+  t->n = int(ptsx.size());
+  for (int i = 0; i < t->n; ++i) {
+    t->ptsx[i] = ptsx[i];
+    t->ptsy[i] = ptsy[i];
+  }
+  return true;
+}
+
+// Format an actuation as a Socket.IO "steer" event into msg, with or
+// without the paths to display.
+void WriteSteerEvent(const Actuation& act, bool viz, std::string* msg) {
+  // The keys go in the sorted order of the original json reply
+  socketio::EventWriter w(msg, "steer");
+  if (viz) {
+    // Visualization only, sent with reduced precision
+    w.Array("mpc_x", act.mpc_x, act.n_mpc, kVizPrecision);
+    w.Array("mpc_y", act.mpc_y, act.n_mpc, kVizPrecision);
+    w.Array("next_x", act.next_x, act.n_next, kVizPrecision);
+    w.Array("next_y", act.next_y, act.n_next, kVizPrecision);
+  }
+  w.Number("steering_angle", act.steering_angle);
+  w.Number("throttle", act.throttle);
+  w.End();
 }
 
-// Evaluate a polynomial.
-double polyeval(Eigen::VectorXd coeffs, double x) {
-  double result = 0.0;
-  for (int i = 0; i < coeffs.size(); i++) {
-    result += coeffs[i] * pow(x, i);
+// Whether a point of path (x, y) lies farther than kVizTolerance from the
+// same point of (x0, y0).
+bool PathMoved(const double* x, const double* y, const double* x0,
+               const double* y0, int n) {
+  for (int i = 0; i < n; ++i) {
+    if (fabs(x[i] - x0[i]) > kVizTolerance ||
+        fabs(y[i] - y0[i]) > kVizTolerance) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether the reply to act carries the visualization: every interval-th
+// reply, or with an interval of 0 when it differs from the one last sent.
+bool ShouldSendViz(Connection* conn, const Actuation& act, int interval) {
+  if (interval > 0) return conn->replies % interval == 0;
+
+  const Actuation& sent = conn->viz_sent;
+  if (act.n_next == sent.n_next && act.n_mpc == sent.n_mpc &&
+      !PathMoved(act.next_x, act.next_y, sent.next_x, sent.next_y, act.n_next) &&
+      !PathMoved(act.mpc_x, act.mpc_y, sent.mpc_x, sent.mpc_y, act.n_mpc)) {
+    return false;
   }
-  return result;
+  conn->viz_sent = act;
+  return true;
 }
 
-// Fit a polynomial.
-// Adapted from
-// https://github.com/JuliaMath/Polynomials.jl/blob/master/src/Polynomials.jl#L676-L716
-Eigen::VectorXd polyfit(Eigen::VectorXd xvals, Eigen::VectorXd yvals,
-                        int order) {
-  assert(xvals.size() == yvals.size());
-  assert(order >= 1 && order <= xvals.size() - 1);
-  Eigen::MatrixXd A(xvals.size(), order + 1);
+// The priority class asked for by "priority=high|normal|low" in the query
+// of a websocket URL, normal if none.
+int ParsePriority(const uWS::Header& url) {
+  const std::string u(url.value, url.valueLength);
+  const size_t query = u.find('?');
+  if (query == std::string::npos) return kNormalPriority;
+  if (u.find("priority=high", query) != std::string::npos) return kHighPriority;
+  if (u.find("priority=low", query) != std::string::npos) return kLowPriority;
+  return kNormalPriority;
+}
+
+void ReportOverload(const OverloadStats& stats, size_t queued) {
+  std::cout << "Telemetry frames " << stats.received << ": "
+            << stats.tracked << " tracked, " << stats.coalesced << " coalesced, " << stats.degraded
+            << " degraded, " << stats.shed << " shed, " << queued
+            << " queued" << std::endl;
+}
 
-  for (int i = 0; i < xvals.size(); i++) {
-    A(i, 0) = 1.0;
+// Watches a solver process of the batch planner for its result.
+struct PlannerWatch {
+  uv_poll_t poll;
+  PlanService* service;
+  int worker;
+};
+
+// Turn a batch planning request away with a JSON error.
+void RejectPlan(uWS::HttpResponse* res, const std::string& error) {
+  json reply;
+  reply["error"] = error;
+  std::string body = reply.dump();
+  body += '\n';
+  res->end(body.data(), body.size());
+}
+
+// Encode the reply to a solved job into its connection's buffer, in the
+// format the telemetry came in.
+void EncodeReply(Job* job, int viz_interval) {
+  Connection* conn = job->conn;
+  Actuation& act = job->actuation;
+  const bool viz = ShouldSendViz(conn, act, viz_interval);
+  conn->replies++;
+  if (job->binary) {
+    if (!viz) {
+      act.n_next = 0;
+      act.n_mpc = 0;
+    }
+    conn->out.resize(wire::kMaxFrameSize);
+    size_t n = wire::EncodeActuation(
+        act, reinterpret_cast<uint8_t*>(&conn->out[0]));
+    conn->out.resize(n);
+  } else {
+    WriteSteerEvent(act, viz, &conn->out);
   }
+}
+
+void SendReply(Job* job, int viz_interval) {
+  Connection* conn = job->conn;
+  EncodeReply(job, viz_interval);
+  conn->ws.send(conn->out.data(), conn->out.size(),
+                job->binary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT);
+}
+
+// Seconds since a frame arrived.
+double SecondsSince(std::chrono::steady_clock::time_point arrived) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       arrived).count();
+}
+
+// Latency
+// The purpose is to mimic real driving conditions where
+// the car does actuate the commands instantly.
+//
+// Feel free to play around with this value but should be to drive
+// around the track with 100ms latency.
+//
+// NOTE: REMEMBER TO SET THIS TO 100 MILLISECONDS BEFORE
+// SUBMITTING.
+//
+// Rather than idle meanwhile, the controller solves ahead for the next
+// frame, expected after the reply act to t.
+void SimulateLatency(Controller& controller, const Telemetry& t,
+                     const Actuation& act, int horizon) {
+  const auto start = chrono::steady_clock::now();
+  const double delay = controller.actuator_delay();
+  controller.Speculate(t, act, horizon, delay);
+  this_thread::sleep_until(start + chrono::milliseconds(int(delay*1000)));
+}
 
-  for (int j = 0; j < xvals.size(); j++) {
-    for (int i = 0; i < order; i++) {
-      A(j, i + 1) = A(j, i) * xvals(j);
+// Serve a co-located simulator over the shared-memory channel of a vehicle
+// instead of websockets.
+int ServeSharedMemory(int vehicle) {
+  ShmChannel channel;
+  if (!channel.Create(vehicle)) {
+    std::cerr << "Failed to create shared memory channel for vehicle "
+              << vehicle << std::endl;
+    return -1;
+  }
+  std::cout << "Serving vehicle " << vehicle << " over shared memory"
+            << std::endl;
+
+  Controller controller;
+  Telemetry telemetry;
+  Actuation actuation;
+  uint64_t invalid = 0;
+  while (true) {
+    if (!channel.ReceiveTelemetry(&telemetry, -1)) {
+      if (channel.invalid() != invalid) {
+        invalid = channel.invalid();
+        std::cerr << "Bad telemetry: waypoints" << std::endl;
+      }
+      continue;
+    }
+    const auto arrived = std::chrono::steady_clock::now();
+    controller.Step(telemetry, &actuation);
+    controller.RecordProcessing(SecondsSince(arrived));
+    SimulateLatency(controller, telemetry, actuation, 0);
+    if (!channel.SendActuation(actuation)) {
+      std::cerr << "Actuation ring full, reply dropped" << std::endl;
     }
   }
+}
 
-  auto Q = A.householderQr();
-  auto result = Q.solve(yvals);
-  return result;
+// Serve a simulator sending sequence-numbered telemetry datagrams to the
+// given UDP port. Only the newest telemetry is acted on.
+int ServeUdp(int port) {
+  UdpChannel channel;
+  if (!channel.Bind(port)) {
+    std::cerr << "Failed to bind UDP port " << port << std::endl;
+    return -1;
+  }
+  std::cout << "Listening to UDP port " << port << std::endl;
+
+  Controller controller;
+  Telemetry telemetry;
+  Actuation actuation;
+  while (true) {
+    uint64_t seq;
+    if (!channel.ReceiveTelemetry(&telemetry, &seq, -1)) continue;
+    const auto arrived = std::chrono::steady_clock::now();
+    controller.Step(telemetry, &actuation);
+    controller.RecordProcessing(SecondsSince(arrived));
+    SimulateLatency(controller, telemetry, actuation, 0);
+    channel.SendActuation(seq, actuation);
+  }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+  if (argc > 2 && strcmp(argv[1], "--shm") == 0) {
+    return ServeSharedMemory(atoi(argv[2]));
+  }
+  if (argc > 2 && strcmp(argv[1], "--udp") == 0) {
+    return ServeUdp(atoi(argv[2]));
+  }
+
+  int viz_interval = kDefaultVizInterval;
+  // Solver processes of the batch planner; none unless asked for
+  int plan_workers = 0;
+  int queue_limit = kDefaultQueueLimit;
+  double replan_interval = kDefaultReplanInterval;
+  int horizon = 0;
+  MPC::Terminal terminal = MPC::kNoTerminal;
+  Integrator integrator = kEuler;
+  double time_step = 0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--viz") == 0) viz_interval = atoi(argv[i + 1]);
+    if (strcmp(argv[i], "--queue-limit") == 0) {
+      queue_limit = std::max(1, atoi(argv[i + 1]));
+    }
+    if (strcmp(argv[i], "--replan") == 0) replan_interval = atof(argv[i + 1]);
+    if (strcmp(argv[i], "--planners") == 0) {
+      plan_workers = strcmp(argv[i + 1], "cores") == 0
+                         ? int(std::thread::hardware_concurrency())
+                         : atoi(argv[i + 1]);
+      plan_workers = std::max(1, plan_workers);
+    }
+    if (strcmp(argv[i], "--horizon") == 0) {
+      horizon = std::max(3, atoi(argv[i + 1]));
+    }
+    if (strcmp(argv[i], "--terminal") == 0) {
+      if (strcmp(argv[i + 1], "cost") == 0) terminal = MPC::kTerminalCost;
+      if (strcmp(argv[i + 1], "set") == 0) terminal = MPC::kTerminalSet;
+    }
+    if (strcmp(argv[i], "--integrator") == 0) {
+      if (strcmp(argv[i + 1], "rk2") == 0) integrator = kRK2;
+      if (strcmp(argv[i + 1], "rk4") == 0) integrator = kRK4;
+      if (strcmp(argv[i + 1], "exact") == 0) integrator = kExact;
+    }
+    if (strcmp(argv[i], "--dt") == 0) time_step = atof(argv[i + 1]);
+  }
+
+  // Solver processes of the batch planner, forked before any thread starts
+  SolverPool planners;
+  if (!planners.Start(plan_workers)) {
+    std::cerr << "Failed to start the solver processes" << std::endl;
+    return -1;
+  }
+
   uWS::Hub h;
 
-  // MPC is initialized here!
-  MPC mpc;
+  // MPC is initialized here, one per connection!
+  auto configure = [horizon, terminal, integrator,
+                    time_step](Controller* controller) {
+    controller->set_horizon(horizon);
+    controller->set_terminal(terminal);
+    controller->set_integrator(integrator);
+    if (time_step > 0) controller->set_time_step(time_step);
+  };
+
+  // Solves run on the solver thread, so the event loop is never blocked by
+  // one: it keeps answering pings and reading frames meanwhile. The solver
+  // wakes the loop through replies_ready to send the replies.
+  uv_async_t replies_ready;
+  WorkerThread<Job> solver(
+      [](Job* job) {
+        Controller& controller = job->conn->controller;
+        controller.Step(job->telemetry, &job->actuation, job->horizon,
+                        &job->plan);
+        std::cout << "Cost " << controller.cost() << std::endl;
+        controller.RecordProcessing(SecondsSince(job->arrived));
+        if (!job->answered) {
+          SimulateLatency(controller, job->telemetry, job->actuation,
+                          job->horizon);
+        }
+      },
+      [&replies_ready] { uv_async_send(&replies_ready); }, kPriorities);
+
+  // Jobs back from the solver, and jobs free for reuse
+  std::vector<Job*> done;
+  std::vector<Job*> free_jobs;
+
+  std::function<void()> send_replies = [&solver, &done, &free_jobs,
+                                        viz_interval] {
+    solver.Collect(&done);
+    for (Job* job : done) {
+      Connection* conn = job->conn;
+      conn->pending--;
+      if (conn->queued == job) conn->queued = nullptr;
+      if (!conn->closed) {
+        job->plan.made = job->arrived;
+        conn->plan = job->plan;
+        if (!job->answered) SendReply(job, viz_interval);
+      } else if (conn->pending == 0) {
+        delete conn;
+      }
+      free_jobs.push_back(job);
+    }
+    done.clear();
+  };
+  uv_async_init(h.getLoop(), &replies_ready, [](uv_async_t* async) {
+    (*static_cast<std::function<void()>*>(async->data))();
+  });
+  replies_ready.data = &send_replies;
+
+  auto new_job = [&free_jobs](Connection* conn, bool binary) {
+    Job* job;
+    if (free_jobs.empty()) {
+      job = new Job;
+    } else {
+      job = free_jobs.back();
+      free_jobs.pop_back();
+    }
+    job->conn = conn;
+    job->binary = binary;
+    job->arrived = std::chrono::steady_clock::now();
+    job->answered = false;
+    return job;
+  };
+
+  // Admission: a frame takes the place of its connection's frame still
+  // queued, if any. Otherwise it is queued according to the depth of the
+  // queue and its connection's priority class, or shed. A shed frame of a
+  // connection without a reply on its way is answered right away by the
+  // geometric controller; with one on its way, it is dropped.
+  OverloadStats overload = OverloadStats();
+  const int degraded_horizon =
+      horizon > 0 ? std::min(horizon, kDegradedHorizon) : kDegradedHorizon;
+  auto submit = [&solver, &free_jobs, &overload, queue_limit,
+                 degraded_horizon, viz_interval](Job* job) {
+    Connection* conn = job->conn;
+    if (++overload.received % kOverloadReportInterval == 0) {
+      ReportOverload(overload, solver.queued());
+    }
+
+    Job* old = conn->queued;
+    if (old != nullptr && solver.Replace(old, job)) {
+      job->horizon = old->horizon;
+      conn->queued = job;
+      free_jobs.push_back(old);
+      overload.coalesced++;
+      return;
+    }
+
+    const size_t depth = solver.queued();
+    const size_t limit = size_t(std::max(1, queue_limit >> conn->priority));
+    if (depth >= limit) {
+      overload.shed++;
+      if (conn->pending == 0 && !job->answered) {
+        PurePursuit(job->telemetry, &job->actuation);
+        SendReply(job, viz_interval);
+      }
+      free_jobs.push_back(job);
+      return;
+    }
+    job->horizon = 0;
+    if (2 * depth >= limit) {
+      job->horizon = degraded_horizon;
+      overload.degraded++;
+    }
+    conn->pending++;
+    conn->queued = job;
+    solver.Submit(job, conn->priority);
+  };
+
+  // Two-rate control: with a replan interval, a frame is answered right
+  // away by tracking its connection's plan while that lasts, and solved
+  // only for a new plan once the plan is older than the interval and no
+  // solve is under way.
+  auto handle = [&submit, &free_jobs, &overload, replan_interval,
+                 viz_interval](Job* job) {
+    Connection* conn = job->conn;
+    if (replan_interval > 0) {
+      const double age = std::chrono::duration<double>(
+                             job->arrived - conn->plan.made).count();
+      // Answered at once, so only the actuators delay it
+      if (TrackPlan(conn->plan, job->telemetry, age,
+                    conn->controller.actuator_delay(), &job->actuation)) {
+        overload.tracked++;
+        SendReply(job, viz_interval);
+        if (age < replan_interval || conn->pending > 0) {
+          free_jobs.push_back(job);
+          return;
+        }
+        job->answered = true;
+      }
+    }
+    submit(job);
+  };
+
+  // Buffers of the replies sent from the event loop
+  std::string pong;
+  uint8_t frame[wire::kMaxFrameSize];
+
+  // Telemetry data object, re-parsed in place every message. Frames share
+  // their shape, so after the first one parsing only overwrites numbers.
+  json j;
+
+  h.onMessage([&frame, &pong, &j, &free_jobs, &new_job, &handle](
+                  uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length,
+                  uWS::OpCode opCode) {
+    Connection* conn = static_cast<Connection*>(ws.getUserData());
+    if (opCode == uWS::OpCode::BINARY) {
+      // Binary wire format, see wire.h
+      const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+      switch (wire::PeekType(in, length)) {
+        case wire::kHello: {
+          uint16_t version;
+          if (!wire::DecodeHello(in, length, &version) || version < 1) {
+            ws.close();
+            return;
+          }
+          conn->binary = true;
+          size_t n = wire::EncodeHello(std::min(version, wire::kVersion), frame);
+          ws.send(reinterpret_cast<const char*>(frame), n, uWS::OpCode::BINARY);
+          break;
+        }
+        case wire::kTelemetry: {
+          Job* job = new_job(conn, true);
+          if (!conn->binary ||
+              !wire::DecodeTelemetry(in, length, &job->telemetry)) {
+            free_jobs.push_back(job);
+            ws.close();
+            return;
+          }
+          handle(job);
+          break;
+        }
+        default:
+          ws.close();
+          break;
+      }
+      return;
+    }
 
-  h.onMessage([&mpc](uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length,
-                     uWS::OpCode opCode) {
     // "42" at the start of the message means there's a websocket message event.
     // The 4 signifies a websocket message
     // The 2 signifies a websocket event
-    string sdata = string(data).substr(0, length);
-    //cout << sdata << endl;
-    if (sdata.size() > 2 && sdata[0] == '4' && sdata[1] == '2') {
-      string s = hasData(sdata);
-      if (s != "") {
-        auto j = json::parse(s);
-        string event = j[0].get<string>();
-        if (event == "telemetry") {
-          // j[1] is the data JSON object
-          vector<double> ptsx = j[1]["ptsx"];
-          vector<double> ptsy = j[1]["ptsy"];
-          double px = j[1]["x"];
-          double py = j[1]["y"];
-          double psi = j[1]["psi"];
-          double v = j[1]["speed"];
-          double delta = j[1]["steering_angle"];
-	  double a = j[1]["throttle"];
-
-	  delta *= -1; // Adjust for negative steering angle
-
-	  // Way-points from the car's perspective
-	  Eigen::VectorXd xvals(ptsx.size());
-	  Eigen::VectorXd yvals(ptsy.size());
-
-	  // Let's fill in the waypoints information by translating to origin
-	  // and rotating the coordinate system to make the xvals horizontal
-	  for (size_t i = 0; i < ptsx.size(); ++i) {
-	    // Translate
-	    double x_trans = ptsx[i]-px;
-	    double y_trans = ptsy[i]-py;
-
-	    // Rotate
-	    xvals[i] = x_trans*cos(-psi) - y_trans*sin(-psi);
-	    yvals[i] = x_trans*sin(-psi) + y_trans*cos(-psi);
-	  }
-
-	  auto coeffs = polyfit(xvals, yvals, 3);
-
-	  double cte = polyeval(coeffs, 0);
-	  double epsi = atan(coeffs[1]);
-
-	  // Latency adjustment
-	  double dt_lat = 0.1;
-	  double x0 = 0;
-	  double y0 = 0;
-	  double psi0 = 0;
-	  double v0 = v;
-	  double Lf = 2.67;
-
-	  if (dt_lat>0) {
-	    // Updated using the initial steering angle
-	    x0   += v*cos(delta)*dt_lat;
-	    y0   += v*sin(delta)*dt_lat;
-	    psi0 += v*delta/Lf*dt_lat;
-	    v0   += a*dt_lat;
-
-	    // Using the kinematic update for the cte and epsi
-	    cte += v*sin(delta)*dt_lat;
-	    epsi += v*delta/Lf*dt_lat;
-
-	    // While we can use the kinematic update equations to update CTE and EPSE (as
-	    // suggested by the first reviewer), re-avaluating using the polynomial using
-	    // the updated x0 (from latency) is better as it provides a nonlinear and
-	    // more accurate update.
-	    /*
-	    cte = polyeval(coeffs, x0);
-	    epsi = atan(1*coeffs[1] +
-			2*coeffs[2]*x0 +
-			3*coeffs[3]*x0*x0);
-	    */
-	      }
-
-	  // Fill the state and solve for vars
-	  Eigen::VectorXd state(6);
-	  state << x0, y0, psi0, v0, cte, epsi;
-
-	  auto vars = mpc.Solve(state, coeffs);
-
-          double steer_value    =  -vars[0]; // Steering angle is negative in rotated coordinates
-          double throttle_value =  vars[1];
-
-          json msgJson;
-          // NOTE: Remember to divide by deg2rad(25) before you send the steering value back.
-          // Otherwise the values will be in between [-deg2rad(25), deg2rad(25] instead of [-1, 1].
-          msgJson["steering_angle"] = steer_value;
-          msgJson["throttle"] = throttle_value;
-
-          //Display the waypoints/reference line (Yellow line)
-          vector<double> next_x_vals;
-          vector<double> next_y_vals;
-	  int npoints = 10;
-	  double dn = 5.0;
-	  for (int i = 1; i < npoints+2; ++i) {
-	    next_x_vals.push_back(dn*i);
-	    next_y_vals.push_back(polyeval(coeffs, dn*i));
-	  }
-
-          msgJson["next_x"] = next_x_vals;
-          msgJson["next_y"] = next_y_vals;
-
-	  //Display the MPC predicted trajectory (Green line)
-          vector<double> mpc_x_vals;
-          vector<double> mpc_y_vals;
-	  for (size_t i = 2; i < vars.size(); ++i) {
-	    if (i%2 == 0) {
-	      mpc_x_vals.push_back(vars[i]);
-	    } else {
-	      mpc_y_vals.push_back(vars[i]);
-	    }
-	  }
-
-          msgJson["mpc_x"] = mpc_x_vals;
-          msgJson["mpc_y"] = mpc_y_vals;
-
-          auto msg = "42[\"steer\"," + msgJson.dump() + "]";
-          //std::cout << msg << std::endl;
-          // Latency
-          // The purpose is to mimic real driving conditions where
-          // the car does actuate the commands instantly.
-          //
-          // Feel free to play around with this value but should be to drive
-          // around the track with 100ms latency.
-          //
-          // NOTE: REMEMBER TO SET THIS TO 100 MILLISECONDS BEFORE
-          // SUBMITTING.
-          this_thread::sleep_for(chrono::milliseconds(int(dt_lat*1000)));
-          ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
-        }
+    socketio::Packet packet;
+    if (!socketio::Decode(data, length, &packet)) return;
+    if (packet.engine == socketio::kPing) {
+      // Keepalives are answered right away, never queued behind a solve
+      pong.assign(1, '0' + socketio::kPong);
+      pong.append(packet.data, packet.data_length);
+      ws.send(pong.data(), pong.size(), uWS::OpCode::TEXT);
+      return;
+    }
+    if (packet.type != socketio::kEvent) return;
+
+    if (!socketio::HasData(packet)) {
+      // Manual driving
+      static const char kManual[] = "42[\"manual\",{}]";
+      ws.send(kManual, sizeof(kManual) - 1, uWS::OpCode::TEXT);
+      return;
+    }
+    if (!socketio::IsEvent(packet, "telemetry")) return;
+
+    Job* job = new_job(conn, false);
+    bool ok = false;
+    try {
+      json::parse_into(j, packet.data, packet.data + packet.data_length);
+      ok = ReadTelemetry(j, &job->telemetry);
+      if (!ok) std::cerr << "Bad telemetry: waypoints" << std::endl;
+    } catch (const std::exception& e) {
+      std::cerr << "Bad telemetry: " << e.what() << std::endl;
+    }
+    if (!ok) {
+      free_jobs.push_back(job);
+      return;
+    }
+    handle(job);
+  });
+
+  // Batch planning: POST /plan, see plan_service.h. Results are streamed
+  // back as they complete.
+  PlanService planner(&planners, kMaxPlanBatches,
+                      [](void* client, const std::string& chunk, bool last) {
+    uWS::HttpResponse* res = static_cast<uWS::HttpResponse*>(client);
+    if (last) {
+      res->end(chunk.data(), chunk.size());
+    } else {
+      res->write(chunk.data(), chunk.size());
+    }
+  });
+
+  std::vector<PlannerWatch> planner_watches(planners.size());
+  for (int i = 0; i < planners.size(); ++i) {
+    PlannerWatch& watch = planner_watches[i];
+    watch.service = &planner;
+    watch.worker = i;
+    uv_poll_init(h.getLoop(), &watch.poll, planners.fd(i));
+    watch.poll.data = &watch;
+    uv_poll_start(&watch.poll, UV_READABLE,
+                  [](uv_poll_t* poll, int status, int events) {
+      PlannerWatch* watch = static_cast<PlannerWatch*>(poll->data);
+      if (!watch->service->OnReadable(watch->worker)) uv_poll_stop(poll);
+    });
+  }
+
+  auto open_batch = [&planner](uWS::HttpResponse* res, const char* body,
+                               size_t length) {
+    std::string error;
+    if (!planner.Open(res, body, length, &error)) RejectPlan(res, error);
+  };
+
+  h.onHttpRequest([&open_batch, &overload, &solver](
+                      uWS::HttpResponse *res, uWS::HttpRequest req,
+                      char *data, size_t length, size_t remainingBytes) {
+    uWS::Header url = req.getUrl();
+    if (url.valueLength == 6 && strncmp(url.value, "/stats", 6) == 0) {
+      json stats;
+      stats["received"] = overload.received;
+      stats["tracked"] = overload.tracked;
+      stats["coalesced"] = overload.coalesced;
+      stats["degraded"] = overload.degraded;
+      stats["shed"] = overload.shed;
+      stats["queued"] = solver.queued();
+      std::string body = stats.dump();
+      body += '\n';
+      res->end(body.data(), body.size());
+      return;
+    }
+    if (req.getMethod() == uWS::HttpMethod::METHOD_POST &&
+        url.valueLength == 5 && strncmp(url.value, "/plan", 5) == 0) {
+      if (length + remainingBytes > kMaxPlanBody) {
+        RejectPlan(res, "Batch larger than " + std::to_string(kMaxPlanBody) +
+                            " bytes");
+      } else if (remainingBytes > 0) {
+        // The rest of the body follows in onHttpData
+        res->userData = new std::string(data, length);
       } else {
-        // Manual driving
-        std::string msg = "42[\"manual\",{}]";
-        ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
+        open_batch(res, data, length);
       }
+      return;
     }
-  });
 
-  // We don't need this since we're not using HTTP but if it's removed the
-  // program
-  // doesn't compile :-(
-  h.onHttpRequest([](uWS::HttpResponse *res, uWS::HttpRequest req, char *data,
-                     size_t, size_t) {
     const std::string s = "<h1>Hello world!</h1>";
-    if (req.getUrl().valueLength == 1) {
+    if (url.valueLength == 1) {
       res->end(s.data(), s.length());
     } else {
       // i guess this should be done more gracefully?
@@ -226,12 +682,42 @@ int main() {
     }
   });
 
-  h.onConnection([&h](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
+  h.onHttpData([&open_batch](uWS::HttpResponse *res, char *data,
+                             size_t length, size_t remainingBytes) {
+    std::string* body = static_cast<std::string*>(res->userData);
+    if (body == nullptr) return;
+    body->append(data, length);
+    if (remainingBytes == 0) {
+      res->userData = nullptr;
+      open_batch(res, body->data(), body->size());
+      delete body;
+    }
+  });
+
+  h.onCancelledHttpRequest([&planner](uWS::HttpResponse *res) {
+    delete static_cast<std::string*>(res->userData);
+    res->userData = nullptr;
+    planner.Cancel(res);
+  });
+
+  h.onConnection([&h, &configure](uWS::WebSocket<uWS::SERVER> ws,
+                                  uWS::HttpRequest req) {
+    Connection* conn = new Connection{ws, false, false, 0, std::string(), 0,
+                                      Actuation(), ParsePriority(req.getUrl()),
+                                      nullptr, TrackedPlan(), {}};
+    configure(&conn->controller);
+    ws.setUserData(conn);
     std::cout << "Connected!!!" << std::endl;
   });
 
   h.onDisconnection([&h](uWS::WebSocket<uWS::SERVER> ws, int code,
                          char *message, size_t length) {
+    // Frames still at the solver keep the connection alive until they are
+    // back
+    Connection* conn = static_cast<Connection*>(ws.getUserData());
+    conn->closed = true;
+    if (conn->pending == 0) delete conn;
+    ws.setUserData(nullptr);
     ws.close();
     std::cout << "Disconnected" << std::endl;
   });
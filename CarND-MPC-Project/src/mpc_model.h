@@ -0,0 +1,315 @@
+#ifndef MPC_MODEL_H
+#define MPC_MODEL_H
+
+#include <memory>
+#include <cppad/cppad.hpp>
+#include "Eigen-3.3/Eigen/Core"
+#include "integrator.h"
+
+// The optimization problem the MPC solves, written once for any scalar
+// type: plain doubles, the solver's taped AD type, or forward-mode
+// AutoDiffScalar (see stage_jacobian.h).
+
+// sin(u) / u for the solver's AD type. The tape is recorded once, so both
+// branches go on it. The division never sees 0, not even in the branch
+// left unused.
+template <>
+inline CppAD::AD<double> Sinc(const CppAD::AD<double>& u) {
+  const CppAD::AD<double> small = 1e-4;
+  const CppAD::AD<double> one = 1;
+  const CppAD::AD<double> size = CppAD::abs(u);
+  const CppAD::AD<double> safe = CppAD::CondExpLt(size, small, one, u);
+  return CppAD::CondExpLt(size, small, 1.0 - u * u / 6.0,
+                          CppAD::sin(safe) / safe);
+}
+
+// Start-indices for the various values of a horizon of N steps
+struct Layout {
+  explicit Layout(size_t horizon)
+      : N(horizon),
+        x_start(0),
+        y_start(x_start + N),
+        psi_start(y_start + N),
+        v_start(psi_start + N),
+        cte_start(v_start + N),
+        epsi_start(cte_start + N),
+        delta_start(epsi_start + N),
+        a_start(delta_start + N - 1) {}
+
+  size_t N;
+  size_t x_start;      // N values
+  size_t y_start;      // N values
+  size_t psi_start;    // N values
+  size_t v_start;      // N values
+  size_t cte_start;    // N values
+  size_t epsi_start;   // N values
+  size_t delta_start;  // N-1 values
+  size_t a_start;      // N-1 values
+};
+
+// Variables of a stage: its state, x, y, psi, v, cte and epsi, followed by
+// the actuations, delta and a, held until the next stage.
+const int kStateSize = 6;
+const int kStageSize = 8;
+// Coefficients of the cubic reference path
+const int kCoeffs = 4;
+
+// This is the length from front to CoG that has a similar radius.
+const double Lf = 2.67;
+
+// Telemetry speeds are in mph
+const double kMphToMps = 0.44704;
+
+// Both the reference cross track and orientation errors are 0.
+// The reference velocity is set between 40 - 100 mph.
+const double ref_cte  = 0;
+const double ref_epsi = 0;
+const double ref_v    = 80;
+
+// Weights for the cost function
+const double w_cte    = 1000;
+const double w_epsi   = 1000;
+const double w_dv     = 1;
+const double w_delta  = 100;
+const double w_a      = 10;
+const double w_ddelta = 10;
+const double w_da     = 10;
+
+// Terminal set: bounds on the cross track (m) and orientation (radians)
+// errors of the last state.
+const double kTerminalCte  = 1.0;
+const double kTerminalEpsi = 0.1;
+
+// Cost-to-go P of the infinite-horizon LQR for x1 = A x0 + B u0 with stage
+// cost x'Qx + r u^2, by iterating the discrete Riccati equation.
+template <int n>
+Eigen::Matrix<double, n, n> LqrCostToGo(const Eigen::Matrix<double, n, n>& A,
+                                        const Eigen::Matrix<double, n, 1>& B,
+                                        const Eigen::Matrix<double, n, n>& Q,
+                                        double r) {
+  Eigen::Matrix<double, n, n> P = Q;
+  for (int i = 0; i < 1000; ++i) {
+    const Eigen::Matrix<double, 1, n> BtP = B.transpose() * P;
+    const Eigen::Matrix<double, 1, n> K = BtP * A / (r + BtP.dot(B));
+    const Eigen::Matrix<double, n, n> next =
+        Q + A.transpose() * P * A - A.transpose() * P * B * K;
+    const bool converged = (next - P).cwiseAbs().maxCoeff() <
+                           1e-9 * P.cwiseAbs().maxCoeff();
+    P = next;
+    if (converged) break;
+  }
+  return P;
+}
+
+// Terminal cost of the model linearized about driving straight at the
+// reference speed: cte1 = cte0 + v dt epsi0, epsi1 = epsi0 + v dt/Lf delta0
+// for the lateral errors and v1 = v0 + dt a0 for the speed. The stage cost
+// of the last state is charged already, so only the cost-to-go beyond it
+// is left.
+struct TerminalCost {
+  explicit TerminalCost(double dt) {
+    Eigen::Matrix2d A;
+    A << 1, ref_v * dt,
+         0, 1;
+    Eigen::Vector2d B(0, ref_v * dt / Lf);
+    Eigen::Matrix2d Q = Eigen::Vector2d(w_cte, w_epsi).asDiagonal();
+    lateral = LqrCostToGo<2>(A, B, Q, w_delta) - Q;
+
+    Eigen::Matrix<double, 1, 1> a(1);
+    Eigen::Matrix<double, 1, 1> b(dt);
+    Eigen::Matrix<double, 1, 1> q(w_dv);
+    speed = LqrCostToGo<1>(a, b, q, w_a)(0) - w_dv;
+  }
+
+  Eigen::Matrix2d lateral;
+  double speed;
+};
+
+// Typical magnitudes of the variables by their physical meaning: the
+// positions (m) over a horizon, heading (radians), speed (mph), errors (m,
+// radians) and actuations.
+const double kPositionRange = 50;
+const double kHeadingRange  = 1;
+const double kSpeedRange    = ref_v;
+const double kCteRange      = 1;
+const double kEpsiRange     = 0.2;
+const double kSteeringRange = 0.436332;
+const double kThrottleRange = 1;
+// And of the deviation from the reference speed (mph)
+const double kSpeedErrorRange = 10;
+
+// Scaling of the problem from the magnitudes above. The solver sees each
+// variable divided by its magnitude, each dynamics constraint by the
+// magnitude of the state it constrains, and the cost by the cost of a
+// horizon of typical errors and actuations, so that all of them are about
+// 1 whatever their units and weights.
+struct Scaling {
+  explicit Scaling(const Layout& layout) : layout(layout) {
+    const double N = double(layout.N);
+    cost = N * (w_cte * kCteRange * kCteRange +
+                w_epsi * kEpsiRange * kEpsiRange +
+                w_dv * kSpeedErrorRange * kSpeedErrorRange) +
+           (N - 1) * (w_delta * kSteeringRange * kSteeringRange +
+                      w_a * kThrottleRange * kThrottleRange) +
+           (N - 2) * (w_ddelta * kSteeringRange * kSteeringRange +
+                      w_da * kThrottleRange * kThrottleRange);
+  }
+
+  // Magnitude of variable i, which is also that of constraint i: the
+  // constraints are laid out as the states they constrain.
+  double range(size_t i) const {
+    static const double states[kStateSize] = {
+        kPositionRange, kPositionRange, kHeadingRange,
+        kSpeedRange,    kCteRange,      kEpsiRange};
+    if (i < layout.delta_start) return states[i / layout.N];
+    return i < layout.a_start ? kSteeringRange : kThrottleRange;
+  }
+
+  const Layout& layout;
+  // Typical cost of a horizon
+  double cost;
+};
+
+template <class Scalar>
+Scalar Square(const Scalar& x) {
+  return x * x;
+}
+
+// The state at the end of a stage: the model integrated over dt from the
+// stage variables `in`, with the errors taken against the reference path,
+// the polynomial with the kCoeffs coefficients `coeffs`.
+template <class Scalar, class Coeffs>
+void Propagate(const Coeffs& coeffs, Integrator integrator, double dt,
+               const Scalar* in, Scalar* out) {
+  using std::atan2;
+  const Scalar& x0     = in[0];
+  const Scalar& y0     = in[1];
+  const Scalar& psi0   = in[2];
+  const Scalar& v0     = in[3];
+  const Scalar& epsi0  = in[5];
+  const Scalar& delta0 = in[6];
+  const Scalar& a0     = in[7];
+
+  // Apply polynomial equation for CTE
+  const Scalar f0 = coeffs[0] + coeffs[1] * x0 + coeffs[2] * x0 * x0 +
+                    coeffs[3] * x0 * x0 * x0;
+
+  // Tangent for psi, as atan2 since every backend has that one
+  const Scalar slope = coeffs[1] + 2.0 * coeffs[2] * x0 +
+                       3.0 * coeffs[3] * x0 * x0;
+  const Scalar psides0 = atan2(slope, Scalar(1.0));
+
+  const Motion<Scalar> pose =
+      Integrate(integrator, Motion<Scalar>{x0, y0, psi0, v0}, delta0, a0, dt,
+                Lf);
+  // The errors move as a car at the offset and heading error from the path
+  // would
+  const Motion<Scalar> error =
+      Integrate(integrator, Motion<Scalar>{Scalar(0.0), Scalar(f0 - y0), epsi0,
+                                           v0},
+                delta0, a0, dt, Lf);
+  out[0] = pose.x;
+  out[1] = pose.y;
+  out[2] = pose.psi;
+  out[3] = pose.v;
+  out[4] = error.y;
+  out[5] = (psi0 - psides0) + (error.psi - epsi0);
+}
+
+// The one-step dynamics as a CppAD checkpoint function: recorded once on
+// a tape of its own, which every stage then calls as a single operation
+// instead of recording the same polynomial, atan2, sin and cos again. Its
+// derivatives of every order and their sparsity come from that small tape.
+// The path is an input like the stage variables, so one recording serves
+// every path for as long as the integrator and step stay the same.
+class StageDynamics {
+ public:
+  typedef CPPAD_TESTVECTOR(CppAD::AD<double>) ADvector;
+
+  // Records the dynamics. CppAD records one tape per thread at a time, so
+  // construct it before the tape of the problem starts, not while the
+  // solver records that. Any inputs will do: the dynamics take the same
+  // operations for all of them.
+  StageDynamics(Integrator integrator, double dt) : model_{integrator, dt} {
+    ADvector in(kStageSize + kCoeffs);
+    ADvector out(kStateSize);
+    for (size_t i = 0; i < in.size(); ++i) in[i] = 0.0;
+    checkpoint_.reset(
+        new CppAD::checkpoint<double>("stage", model_, in, out));
+  }
+
+  Integrator integrator() const { return model_.integrator; }
+  double dt() const { return model_.dt; }
+
+  // The state a stage ends in from its kStageSize variables followed by
+  // the kCoeffs coefficients of the path.
+  void operator()(const ADvector& in, ADvector& out) {
+    (*checkpoint_)(in, out);
+  }
+
+ private:
+  // What the checkpoint records
+  struct Model {
+    void operator()(const ADvector& in, ADvector& out) const {
+      Propagate(&in[kStageSize], integrator, dt, &in[0], &out[0]);
+    }
+
+    Integrator integrator;
+    double dt;
+  };
+
+  Model model_;
+  std::unique_ptr<CppAD::checkpoint<double>> checkpoint_;
+};
+
+// Cost of the states and actuations `vars` of a horizon, and the terminal
+// cost if any.
+template <class Scalar, class Vector>
+Scalar Cost(const Layout& layout, const Vector& vars,
+            const TerminalCost* terminal) {
+  const size_t N = layout.N;
+  Scalar cost = 0.0;
+
+  for (size_t t = 0; t < N; t++) {
+    // Minimize cross-track error
+    cost += w_cte  * Square(vars[layout.cte_start + t]);
+
+    // Minimize error in direction
+    cost += w_epsi * Square(vars[layout.epsi_start + t]);
+
+    // Minimize deviation from reference velocity
+    cost += w_dv * Square(vars[layout.v_start + t] - ref_v);
+  }
+
+  for (size_t t = 0; t < N - 1; t++) {
+    // Minimize use of steering
+    cost += w_delta * Square(vars[layout.delta_start + t]);
+
+    // Minimize use of throttle
+    cost += w_a * Square(vars[layout.a_start + t]);
+  }
+
+  for (size_t t = 0; t < N - 2; t++) {
+    // Minimize sudden turns
+    cost += w_ddelta * Square(vars[layout.delta_start + t + 1] -
+                              vars[layout.delta_start + t]);
+
+    // Minimize sudden accelerations or braking
+    cost += w_da * Square(vars[layout.a_start + t + 1] -
+                          vars[layout.a_start + t]);
+  }
+
+  if (terminal != nullptr) {
+    // Cost-to-go of the last state the model constrains
+    const size_t T = N - 2;
+    const Eigen::Matrix2d& P = terminal->lateral;
+    const Scalar cte  = vars[layout.cte_start  + T];
+    const Scalar epsi = vars[layout.epsi_start + T];
+    cost += P(0, 0) * cte * cte + 2 * P(0, 1) * cte * epsi +
+            P(1, 1) * epsi * epsi;
+    cost += terminal->speed * Square(vars[layout.v_start + T] - ref_v);
+  }
+  return cost;
+}
+
+#endif /* MPC_MODEL_H */
@@ -0,0 +1,482 @@
+// Closed-loop benchmark of the controller: drives a simulated car around the
+// lake track and reports how well it tracks the waypoints and how long the
+// solves take, for a range of horizons, terminal ingredients and
+// integrators of the model.
+//
+//   mpcbench [seconds] [waypoints.csv]
+//   mpcbench accuracy
+//   mpcbench derivatives
+//   mpcbench allocations
+//
+// The second compares the integrators of the model alone: how far off
+// their prediction over a fixed lookahead ends up for a range of steps.
+// The third times the derivatives of the dynamics constraints by CppAD,
+// as the solver takes them, with and without the stage checkpoint, against
+// the forward-mode stage Jacobians. The fourth counts the heap allocations
+// of a solve once its workspace has seen the horizon.
+//
+// The car is a kinematic bicycle in the simulator's conventions. Telemetry
+// comes every kFramePeriod and each actuation takes effect after the
+// controller's actuator delay plus the time its solve actually took, so
+// slower configurations pay for their solves in latency as they would on
+// the road.
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "controller.h"
+#include "integrator.h"
+#include "mpc_model.h"
+#include "stage_jacobian.h"
+#include "telemetry.h"
+
+using std::chrono::steady_clock;
+
+// Heap allocations so far by the solver's own work and by everything
+// else, counted for the allocations mode
+static std::atomic<long> allocations(0);
+static std::atomic<long> solver_allocations(0);
+static thread_local bool in_solver = false;
+
+void* operator new(size_t size) {
+  (in_solver ? solver_allocations : allocations)++;
+  if (void* p = std::malloc(size > 0 ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+const double kFramePeriod = 0.1;    // simulated seconds between frames
+const double kSimStep = 0.005;      // integration step of the car (s)
+const double kMaxSteering = 25 * M_PI / 180;  // at steering_angle 1
+const double kMaxAccel = 5.0;       // m/s^2 at full throttle
+const double kOffTrack = 4.0;       // m from the waypoint path
+const int kWaypoints = 6;           // sent with each frame
+
+struct Car {
+  double x;
+  double y;
+  double psi;
+  double speed;  // mph
+  double steering_angle;
+  double throttle;
+};
+
+// An actuation waiting for the actuator delay to pass.
+struct Pending {
+  double at;
+  double steering_angle;
+  double throttle;
+};
+
+// Controller settings of one run.
+struct Config {
+  int horizon;
+  MPC::Terminal terminal;
+  Integrator integrator;
+  double time_step;
+  bool scaling;
+};
+
+// Result of one run.
+struct Run {
+  double seconds;
+  double distance;
+  double mean_cte;
+  double max_cte;
+  double mean_speed;
+  std::vector<double> solve_ms;
+  bool off_track;
+};
+
+static bool ReadWaypoints(const char* path, std::vector<double>* x,
+                          std::vector<double>* y) {
+  std::ifstream in(path);
+  std::string line;
+  if (!std::getline(in, line)) return false;  // header
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    double px;
+    double py;
+    char comma;
+    if (fields >> px >> comma >> py) {
+      x->push_back(px);
+      y->push_back(py);
+    }
+  }
+  return x->size() > size_t(kWaypoints);
+}
+
+// Distance from (px, py) to the closed polyline (x, y), and the index of
+// the waypoint closest to it.
+static double DistanceToPath(const std::vector<double>& x,
+                             const std::vector<double>& y, double px,
+                             double py, size_t* closest) {
+  const size_t n = x.size();
+  double best = 1e300;
+  double best_point = 1e300;
+  for (size_t i = 0; i < n; ++i) {
+    const size_t j = (i + 1) % n;
+    const double dx = x[j] - x[i];
+    const double dy = y[j] - y[i];
+    const double l2 = dx * dx + dy * dy;
+    double s = l2 > 0 ? ((px - x[i]) * dx + (py - y[i]) * dy) / l2 : 0;
+    s = std::min(1.0, std::max(0.0, s));
+    best = std::min(best, hypot(px - x[i] - s * dx, py - y[i] - s * dy));
+    const double d = hypot(px - x[i], py - y[i]);
+    if (d < best_point) {
+      best_point = d;
+      *closest = i;
+    }
+  }
+  return best;
+}
+
+static Run Drive(const std::vector<double>& wx, const std::vector<double>& wy,
+                 const Config& config, double seconds) {
+  Controller controller;
+  controller.set_horizon(config.horizon);
+  controller.set_terminal(config.terminal);
+  controller.set_integrator(config.integrator);
+  controller.set_time_step(config.time_step);
+  controller.set_scaling(config.scaling);
+
+  const size_t n = wx.size();
+  Car car = {wx[0], wy[0], atan2(wy[1] - wy[0], wx[1] - wx[0]), 0, 0, 0};
+  std::deque<Pending> pending;
+  Run run = Run();
+  double cte_sum = 0;
+  double speed_sum = 0;
+  int frames = 0;
+
+  double t = 0;
+  double next_frame = 0;
+  while (t < seconds) {
+    if (t >= next_frame) {
+      next_frame += kFramePeriod;
+      size_t closest = 0;
+      const double cte = DistanceToPath(wx, wy, car.x, car.y, &closest);
+      cte_sum += cte;
+      speed_sum += car.speed;
+      run.max_cte = std::max(run.max_cte, cte);
+      frames++;
+      if (cte > kOffTrack) {
+        run.off_track = true;
+        break;
+      }
+
+      Telemetry telemetry;
+      telemetry.x = car.x;
+      telemetry.y = car.y;
+      telemetry.psi = car.psi;
+      telemetry.speed = car.speed;
+      telemetry.steering_angle = car.steering_angle;
+      telemetry.throttle = car.throttle;
+      telemetry.n = kWaypoints;
+      for (int i = 0; i < kWaypoints; ++i) {
+        telemetry.ptsx[i] = wx[(closest + n - 1 + i) % n];
+        telemetry.ptsy[i] = wy[(closest + n - 1 + i) % n];
+      }
+
+      Actuation actuation;
+      const steady_clock::time_point start = steady_clock::now();
+      controller.Step(telemetry, &actuation);
+      const double solve =
+          std::chrono::duration<double>(steady_clock::now() - start).count();
+      controller.RecordProcessing(solve);
+      run.solve_ms.push_back(solve * 1000);
+      pending.push_back({t + controller.actuator_delay() + solve,
+                         actuation.steering_angle, actuation.throttle});
+    }
+
+    while (!pending.empty() && pending.front().at <= t) {
+      car.steering_angle = std::min(1.0, std::max(-1.0,
+                                    pending.front().steering_angle));
+      car.throttle = std::min(1.0, std::max(-1.0, pending.front().throttle));
+      pending.pop_front();
+    }
+
+    // Positive steering angles turn right
+    const double v = car.speed * kMphToMps;
+    car.x += v * cos(car.psi) * kSimStep;
+    car.y += v * sin(car.psi) * kSimStep;
+    car.psi -= v * car.steering_angle * kMaxSteering / Lf * kSimStep;
+    car.speed = std::max(0.0, car.speed +
+                         car.throttle * kMaxAccel / kMphToMps * kSimStep);
+    run.distance += v * kSimStep;
+    t += kSimStep;
+  }
+
+  run.seconds = t;
+  run.mean_cte = frames > 0 ? cte_sum / frames : 0;
+  run.mean_speed = frames > 0 ? speed_sum / frames : 0;
+  return run;
+}
+
+static const char* kTerminalNames[] = {"none", "cost", "set"};
+static const char* kIntegratorNames[] = {"euler", "rk2", "rk4", "exact"};
+
+static void Report(std::ostream& out, const Config& config, Run& run) {
+  std::sort(run.solve_ms.begin(), run.solve_ms.end());
+  double sum = 0;
+  for (double s : run.solve_ms) sum += s;
+  const size_t n = std::max(size_t(1), run.solve_ms.size());
+  out << "N " << config.horizon << ", dt " << config.time_step << " s, "
+      << kIntegratorNames[config.integrator] << ", terminal "
+      << kTerminalNames[config.terminal]
+      << (config.scaling ? ", scaled" : "") << ": "
+      << (run.off_track ? "off track after " : "")
+      << run.seconds << " s, " << run.distance << " m"
+      << ", cte mean " << run.mean_cte << " m, max " << run.max_cte << " m"
+      << ", speed mean " << run.mean_speed << " mph"
+      << ", solve mean " << sum / n << " ms, p95 "
+      << (run.solve_ms.empty() ? 0 : run.solve_ms[n * 95 / 100]) << " ms"
+      << std::endl;
+}
+
+// Steering (radians) of a test manoeuvre at time t (s): a steady turn, or
+// a slalom.
+static double Steering(bool slalom, double t) {
+  return slalom ? 0.3 * sin(M_PI * t) : 0.2;
+}
+
+// Error of each integrator against a fine reference over a lookahead of
+// kLookahead seconds, with the actuations held over each step as the MPC
+// holds them, for a range of steps. Speeds as in the MPC's model.
+static void Accuracy(std::ostream& out) {
+  const double kLookahead = 2.4;
+  const double kReferenceStep = 1e-4;
+  const double steps[] = {0.05, 0.1, 0.15, 0.2, 0.3, 0.4, 0.6};
+  const Integrator integrators[] = {kEuler, kRK2, kRK4, kExact};
+
+  for (int slalom = 0; slalom < 2; ++slalom) {
+    out << (slalom ? "Slalom" : "Steady turn")
+        << " from 20 m/s accelerating at 1 m/s^2, position error after "
+        << kLookahead << " s (m):" << std::endl;
+    for (double dt : steps) {
+      const int n = int(kLookahead / dt + 0.5);
+      out << "  dt " << dt << " s, " << n << " steps:";
+      for (Integrator integrator : integrators) {
+        Motion<double> fine = {0, 0, 0, 20};
+        Motion<double> coarse = fine;
+        const int substeps = int(dt / kReferenceStep + 0.5);
+        for (int i = 0; i < n; ++i) {
+          const double delta = Steering(slalom, i * dt);
+          coarse = Integrate(integrator, coarse, delta, 1.0, dt, Lf);
+          for (int j = 0; j < substeps; ++j) {
+            fine = Integrate(kRK4, fine, delta, 1.0, kReferenceStep, Lf);
+          }
+        }
+        out << " " << kIntegratorNames[integrator] << " "
+            << hypot(coarse.x - fine.x, coarse.y - fine.y);
+      }
+      out << std::endl;
+    }
+  }
+}
+
+static double MicrosecondsSince(steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(steady_clock::now() - start)
+      .count();
+}
+
+// Jacobian of the dynamics constraints of horizons of a few lengths at a
+// plausible point, by CppAD and by stage, and how far apart they are.
+static void Derivatives(std::ostream& out) {
+  using CppAD::AD;
+  const int kRepeats = 200;
+  const double kTimeStep = 0.15;
+  MPCCoeffs coeffs;
+  coeffs << 0.5, 0.1, -0.01, 0.0005;
+
+  const size_t horizons[] = {8, 15, 30};
+  for (size_t horizon : horizons) {
+    const Layout layout(horizon);
+    const size_t n_vars = horizon * kStateSize + (horizon - 1) * 2;
+    const size_t stages = horizon - 2;
+    const size_t starts[kStageSize] = {
+        layout.x_start,   layout.y_start,     layout.psi_start,
+        layout.v_start,   layout.cte_start,   layout.epsi_start,
+        layout.delta_start, layout.a_start};
+
+    // Driving at 40 along a curve, steering and throttle varying
+    std::vector<double> vars(n_vars);
+    for (size_t t = 0; t < horizon; ++t) {
+      vars[layout.x_start + t] = 6.0 * t;
+      vars[layout.y_start + t] = 0.5 + 0.6 * t;
+      vars[layout.psi_start + t] = 0.1 - 0.02 * t;
+      vars[layout.v_start + t] = 40;
+      vars[layout.cte_start + t] = 0.2 * sin(0.3 * t);
+      vars[layout.epsi_start + t] = 0.05 * cos(0.3 * t);
+      if (t + 1 < horizon) {
+        vars[layout.delta_start + t] = 0.1 * sin(0.5 * t);
+        vars[layout.a_start + t] = 0.5 * cos(0.5 * t);
+      }
+    }
+
+    StageJacobians stage;
+    stage.Evaluate(coeffs, kEuler, kTimeStep, horizon, vars.data());
+    steady_clock::time_point start = steady_clock::now();
+    for (int r = 0; r < kRepeats; ++r) {
+      stage.Evaluate(coeffs, kEuler, kTimeStep, horizon, vars.data());
+    }
+    const double stage_us = MicrosecondsSince(start) / kRepeats;
+    out << "N " << horizon << ": stage Jacobians " << stage_us << " us"
+        << std::endl;
+
+    // CppAD: tape the constraints and take their sparse Jacobian, as the
+    // solver does, with the dynamics of each stage on the tape or called
+    // as a checkpoint
+    for (int checkpoint = 0; checkpoint < 2; ++checkpoint) {
+      start = steady_clock::now();
+      StageDynamics dynamics(kEuler, kTimeStep);
+      CPPAD_TESTVECTOR(AD<double>) ax(n_vars);
+      for (size_t i = 0; i < n_vars; ++i) ax[i] = vars[i];
+      CppAD::Independent(ax);
+      CPPAD_TESTVECTOR(AD<double>) ag(stages * kStateSize);
+      // The checkpoint takes the path after the variables of the stage
+      CPPAD_TESTVECTOR(AD<double>) in(kStageSize + kCoeffs);
+      for (int i = 0; i < kCoeffs; ++i) in[kStageSize + i] = coeffs[i];
+      CPPAD_TESTVECTOR(AD<double>) next(kStateSize);
+      for (size_t t = 0; t < stages; ++t) {
+        for (int i = 0; i < kStageSize; ++i) in[i] = ax[starts[i] + t];
+        if (checkpoint) {
+          dynamics(in, next);
+        } else {
+          Propagate(coeffs, kEuler, kTimeStep, &in[0], &next[0]);
+        }
+        for (int i = 0; i < kStateSize; ++i) {
+          ag[t * kStateSize + i] = ax[starts[i] + t + 1] - next[i];
+        }
+      }
+      CppAD::ADFun<double> f(ax, ag);
+      const double tape_us = MicrosecondsSince(start);
+
+      start = steady_clock::now();
+      std::vector<std::set<size_t>> identity(n_vars);
+      for (size_t i = 0; i < n_vars; ++i) identity[i].insert(i);
+      const std::vector<std::set<size_t>> pattern =
+          f.ForSparseJac(n_vars, identity);
+      const double sparsity_us = MicrosecondsSince(start);
+
+      std::vector<double> x(vars);
+      std::vector<double> jac;
+      start = steady_clock::now();
+      for (int r = 0; r < kRepeats; ++r) {
+        jac = f.SparseJacobian(x, pattern);
+      }
+      const double jacobian_us = MicrosecondsSince(start) / kRepeats;
+
+      // The constraint of a state is that state less the model's
+      // prediction
+      double difference = 0;
+      for (size_t t = 0; t < stages; ++t) {
+        for (int i = 0; i < kStateSize; ++i) {
+          const double* row = &jac[(t * kStateSize + i) * n_vars];
+          for (int j = 0; j < kStageSize; ++j) {
+            difference = std::max(difference, fabs(row[starts[j] + t] +
+                                                   stage.jacobian(t)(i, j)));
+          }
+        }
+      }
+
+      out << "  CppAD" << (checkpoint ? " with checkpoint" : "") << ": tape "
+          << f.size_var() << " variables in " << tape_us << " us, sparsity "
+          << sparsity_us << " us, Jacobian " << jacobian_us
+          << " us, largest difference from the stage Jacobians "
+          << difference << std::endl;
+    }
+  }
+}
+
+// Heap allocations of a solve in a workspace that has solved over the
+// horizon before, with and without the stage checkpoint: the MPC's own and
+// the solver's, CppAD's tape and Ipopt's, which the MPC does not control.
+static void Allocations(std::ostream& out) {
+  const int kSolves = 20;
+  MPCState state;
+  state << 0, 0, 0, 40, 0.5, 0.05;
+  MPCCoeffs coeffs;
+  coeffs << 0.5, 0.1, -0.01, 0.0005;
+
+  for (int checkpoint = 0; checkpoint < 2; ++checkpoint) {
+    MPC mpc;
+    mpc.set_checkpoint(checkpoint != 0);
+    mpc.set_solver_hook([](bool entering) { in_solver = entering; });
+    MPCWorkspace workspace;
+    SolveResult result;
+    mpc.Solve(state, coeffs, &workspace, &result);
+    const long before = allocations;
+    const long solver_before = solver_allocations;
+    for (int i = 0; i < kSolves; ++i) {
+      workspace.WarmStart();
+      mpc.Solve(state, coeffs, &workspace, &result);
+    }
+    out << "Allocations per solve" << (checkpoint ? " with checkpoint" : "")
+        << ": MPC " << double(allocations - before) / kSolves << ", solver "
+        << double(solver_allocations - solver_before) / kSolves
+        << std::endl;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  // The controller reports as it goes; only the results are of interest
+  std::ostream out(std::cout.rdbuf(nullptr));
+
+  if (argc > 1 && strcmp(argv[1], "accuracy") == 0) {
+    Accuracy(out);
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "derivatives") == 0) {
+    Derivatives(out);
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "allocations") == 0) {
+    Allocations(out);
+    return 0;
+  }
+
+  const double seconds = argc > 1 ? atof(argv[1]) : 60;
+  const char* path = argc > 2 ? argv[2] : "../lake_track_waypoints.csv";
+
+  std::vector<double> wx;
+  std::vector<double> wy;
+  if (!ReadWaypoints(path, &wx, &wy)) {
+    std::cerr << "Failed to read waypoints from " << path << std::endl;
+    return -1;
+  }
+
+  std::vector<Config> configs;
+  // Shorter horizons with and without terminal ingredients
+  const int horizons[] = {15, 10, 7, 5};
+  const MPC::Terminal terminals[] = {MPC::kNoTerminal, MPC::kTerminalCost,
+                                     MPC::kTerminalSet};
+  for (int horizon : horizons) {
+    for (MPC::Terminal terminal : terminals) {
+      configs.push_back({horizon, terminal, kEuler, 0.15, false});
+    }
+  }
+  // The default lookahead of about 2 s in half as many steps
+  const Integrator integrators[] = {kEuler, kRK2, kRK4, kExact};
+  for (Integrator integrator : integrators) {
+    configs.push_back({8, MPC::kNoTerminal, integrator, 0.3, false});
+  }
+  // The default, solved scaled
+  configs.push_back({15, MPC::kNoTerminal, kEuler, 0.15, true});
+
+  for (const Config& config : configs) {
+    Run run = Drive(wx, wy, config, seconds);
+    Report(out, config, run);
+  }
+  return 0;
+}
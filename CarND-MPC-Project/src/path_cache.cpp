@@ -0,0 +1,128 @@
+#include "path_cache.h"
+#include <cmath>
+#include <cstring>
+#include "geometry.h"
+
+// The re-expressed fit never looks less than this far ahead (meters).
+const double kMinLookahead = 10.0;
+
+// Newton steps when intersecting the cached curve with the sample lines.
+const int kNewtonSteps = 3;
+
+// FNV-1a over the raw bytes of the waypoints.
+static uint64_t HashWaypoints(const double* ptsx, const double* ptsy, int n) {
+  uint64_t h = 14695981039346656037ULL;
+  const unsigned char* bytes[2] = {
+    reinterpret_cast<const unsigned char*>(ptsx),
+    reinterpret_cast<const unsigned char*>(ptsy)};
+  for (int b = 0; b < 2; ++b) {
+    for (size_t i = 0; i < n * sizeof(double); ++i) {
+      h = (h ^ bytes[b][i]) * 1099511628211ULL;
+    }
+  }
+  return h ^ uint64_t(n);
+}
+
+PathCache::PathCache() : next_slot_(0) {
+  for (int i = 0; i < kSlots; ++i) {
+    slots_[i].valid = false;
+  }
+  for (int k = 0; k < kSamples; ++k) {
+    grid_[k] = double(k) / (kSamples - 1);
+  }
+  sample_fit_.Prefactor(grid_, kSamples);
+  stats_.hits = 0;
+  stats_.misses = 0;
+}
+
+double PathCache::HitRate() const {
+  uint64_t total = stats_.hits + stats_.misses;
+  return total ? double(stats_.hits) / total : 0.0;
+}
+
+PathCache::Window* PathCache::Lookup(uint64_t key, const double* ptsx,
+                                     const double* ptsy, int n) {
+  for (int i = 0; i < kSlots; ++i) {
+    Window& w = slots_[i];
+    if (w.valid && w.key == key && w.n == n &&
+        memcmp(w.ptsx, ptsx, n * sizeof(double)) == 0 &&
+        memcmp(w.ptsy, ptsy, n * sizeof(double)) == 0) {
+      return &w;
+    }
+  }
+  return nullptr;
+}
+
+PathCache::Window* PathCache::Insert(uint64_t key, const double* ptsx,
+                                     const double* ptsy, int n) {
+  Window& w = slots_[next_slot_];
+  next_slot_ = (next_slot_ + 1) % kSlots;
+
+  w.valid = true;
+  w.key = key;
+  w.n = n;
+  memcpy(w.ptsx, ptsx, n * sizeof(double));
+  memcpy(w.ptsy, ptsy, n * sizeof(double));
+
+  // Align the window frame with the chord from the first to the last point
+  w.ox = ptsx[0];
+  w.oy = ptsy[0];
+  w.heading = atan2(ptsy[n - 1] - w.oy, ptsx[n - 1] - w.ox);
+
+  double sx[kMaxWaypoints];
+  double sy[kMaxWaypoints];
+  ToLocalFrame(ptsx, ptsy, n, w.ox, w.oy, w.heading, sx, sy);
+  w.fit = window_fit_.Fit(sx, sy, n);
+  w.s_max = sx[n - 1];
+  return &w;
+}
+
+PathCache::Coeffs PathCache::LocalFit(const double* ptsx, const double* ptsy,
+                                      int n, double px, double py,
+                                      double psi) {
+  if (n > kMaxWaypoints) n = kMaxWaypoints;
+
+  uint64_t key = HashWaypoints(ptsx, ptsy, n);
+  Window* w = Lookup(key, ptsx, ptsy, n);
+  if (w) {
+    stats_.hits++;
+  } else {
+    stats_.misses++;
+    w = Insert(key, ptsx, ptsy, n);
+  }
+
+  // Car pose in the window frame
+  double cx, cy;
+  ToLocalFrame(&px, &py, 1, w->ox, w->oy, w->heading, &cx, &cy);
+  double sn, cs;
+  fast_sincos(psi - w->heading, &sn, &cs);
+
+  // Look ahead as far as the window reaches in front of the car
+  double lookahead = (w->s_max - cx) * cs +
+                     (polyeval(w->fit, w->s_max) - cy) * sn;
+  if (lookahead < kMinLookahead) lookahead = kMinLookahead;
+
+  // Intersect the cached curve s -> (s, g(s)) with the car-frame lines
+  // x = lookahead * grid[k] and record the car-frame y there.
+  double ys[kSamples];
+  for (int k = 0; k < kSamples; ++k) {
+    const double xk = lookahead * grid_[k];
+    double s = cx + xk * cs;
+    for (int it = 0; it < kNewtonSteps; ++it) {
+      double f = (s - cx) * cs + (polyeval(w->fit, s) - cy) * sn - xk;
+      double fp = cs + polyderiv(w->fit, s) * sn;
+      if (fabs(fp) < 1e-6) break;
+      s -= f / fp;
+    }
+    ys[k] = -(s - cx) * sn + (polyeval(w->fit, s) - cy) * cs;
+  }
+
+  // Fit on the normalized grid, then undo the normalization x = L * t
+  Coeffs local = sample_fit_.FitPrefactored(ys);
+  double scale = 1.0;
+  for (int i = 1; i < local.size(); ++i) {
+    scale /= lookahead;
+    local[i] *= scale;
+  }
+  return local;
+}
@@ -0,0 +1,65 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <cstdint>
+#include "polyfit.h"
+
+// Caches the reference path fit per waypoint window.
+//
+// The simulator resends the same waypoints for many consecutive frames. On
+// the first sight of a window the waypoints are fitted once in a frame
+// aligned with the window (origin at the first waypoint, x-axis along the
+// chord to the last one). Every frame then re-expresses that cached curve
+// in the car frame: the curve is sampled on a fixed normalized grid ahead of
+// the car and projected with a prefactored least-squares basis, so no
+// decomposition runs per frame.
+class PathCache {
+ public:
+  static const int kMaxWaypoints = 16;
+  static const int kSlots = 4;
+  static const int kSamples = 8;
+
+  typedef PolyFit<3, kMaxWaypoints> WindowFit;
+  typedef WindowFit::Coeffs Coeffs;
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  PathCache();
+
+  // Cubic y = f(x) of the waypoints in the frame of a car at (px, py) with
+  // heading psi. Only the first kMaxWaypoints points are used.
+  Coeffs LocalFit(const double* ptsx, const double* ptsy, int n,
+                  double px, double py, double psi);
+
+  const Stats& stats() const { return stats_; }
+  double HitRate() const;
+
+ private:
+  struct Window {
+    bool valid;
+    uint64_t key;
+    int n;
+    double ptsx[kMaxWaypoints];
+    double ptsy[kMaxWaypoints];
+    // Window frame pose and the fit within it
+    double ox, oy, heading;
+    Coeffs fit;
+    // Extent of the waypoints along the window x-axis
+    double s_max;
+  };
+
+  Window* Lookup(uint64_t key, const double* ptsx, const double* ptsy, int n);
+  Window* Insert(uint64_t key, const double* ptsx, const double* ptsy, int n);
+
+  Window slots_[kSlots];
+  int next_slot_;
+  WindowFit window_fit_;
+  PolyFit<3, kSamples> sample_fit_;
+  double grid_[kSamples];
+  Stats stats_;
+};
+
+#endif /* PATH_CACHE_H */
@@ -0,0 +1,36 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+// Offline planning problems and their solutions, as served by the batch
+// planning endpoint (see plan_service.h). Both are plain structs with fixed
+// capacity, like the telemetry messages.
+
+// Solve the MPC from a state along a reference path over a horizon.
+struct PlanProblem {
+  static const int kStateSize = 6;
+  static const int kCoeffs = 4;
+  static const int kMinHorizon = 3;
+  static const int kMaxHorizon = 64;
+
+  // x, y, psi, v, cte, epsi in the car frame, as passed to MPC::Solve
+  double state[kStateSize];
+  // Cubic of the reference path, constant term first
+  double coeffs[kCoeffs];
+  // Number of steps
+  int horizon;
+};
+
+// The optimal trajectory of a problem. A problem the solver failed on has
+// no trajectory (n = 0) and NaN actuations.
+struct PlanResult {
+  // First actuations: steering angle (radians, positive to the left) and
+  // throttle
+  double delta;
+  double a;
+  // Predicted positions, first n are valid
+  int n;
+  double x[PlanProblem::kMaxHorizon];
+  double y[PlanProblem::kMaxHorizon];
+};
+
+#endif /* PLAN_H */
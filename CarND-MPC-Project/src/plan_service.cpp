@@ -0,0 +1,258 @@
+#include "plan_service.h"
+#include <algorithm>
+#include <limits>
+#include "json.hpp"
+#include "wire.h"
+
+// Problems are small objects, so store them flat
+using json = nlohmann::basic_json<nlohmann::flat_map>;
+
+// Read between min and max numbers from a JSON array into out, padding up
+// to max with zeros.
+static bool ReadNumbers(const json& array, size_t min, size_t max,
+                        double* out) {
+  if (!array.is_array() || array.size() < min || array.size() > max) {
+    return false;
+  }
+  for (size_t i = 0; i < max; ++i) {
+    if (i >= array.size()) {
+      out[i] = 0;
+    } else if (array[i].is_number()) {
+      out[i] = array[i];
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+PlanService::PlanService(SolverPool* pool, int max_batches, Writer write)
+    : pool_(pool), max_batches_(size_t(max_batches)), write_(write),
+      turn_(0), running_batch_(pool->size(), nullptr),
+      running_index_(pool->size(), 0) {}
+
+PlanService::~PlanService() {
+  for (Batch* batch : batches_) delete batch;
+}
+
+bool PlanService::Open(void* client, const char* body, size_t length,
+                       std::string* error) {
+  if (batches_.size() >= max_batches_) {
+    *error = "Too many batches in progress, retry later";
+    return false;
+  }
+  if (pool_->live() == 0) {
+    *error = "No solver processes";
+    return false;
+  }
+
+  Batch* batch = new Batch{client, false, {}, 0, 0, 0, false};
+  batch->binary = wire::PeekType(reinterpret_cast<const uint8_t*>(body),
+                                 length) == wire::kPlanProblem;
+  bool ok = batch->binary
+                ? ParseBinary(body, length, &batch->problems, error)
+                : ParseJson(body, length, &batch->problems, error);
+  if (!ok) {
+    delete batch;
+    return false;
+  }
+  if (batch->problems.empty()) {
+    write_(client, std::string(), true);
+    delete batch;
+    return true;
+  }
+  batches_.push_back(batch);
+  Dispatch();
+  return true;
+}
+
+void PlanService::Cancel(void* client) {
+  for (Batch* batch : batches_) {
+    // A cancelled batch waiting for its running problems may have a client
+    // that is gone, and whose address a new client now has
+    if (batch->client != client || batch->cancelled) continue;
+    batch->cancelled = true;
+    batch->next = batch->problems.size();
+    Retire(batch);
+    return;
+  }
+}
+
+bool PlanService::OnReadable(int worker) {
+  Batch* batch = running_batch_[worker];
+  const size_t index = running_index_[worker];
+  running_batch_[worker] = nullptr;
+
+  PlanResult r;
+  const bool ok = pool_->Receive(worker, &r);
+  if (batch != nullptr) {
+    batch->running--;
+    // The worker sends no trajectory for a solve that failed
+    Answer(batch, index, ok && r.n > 0 ? &r : nullptr);
+    Retire(batch);
+  }
+  Dispatch();
+  return ok;
+}
+
+void PlanService::Dispatch() {
+  for (int i = 0; i < pool_->size() && !batches_.empty(); ++i) {
+    if (!pool_->idle(i)) continue;
+
+    // The next batch in turn with problems left
+    Batch* batch = nullptr;
+    for (size_t k = 0; k < batches_.size(); ++k) {
+      Batch* b = batches_[(turn_ + k) % batches_.size()];
+      if (b->next < b->problems.size()) {
+        batch = b;
+        turn_ = (turn_ + k + 1) % batches_.size();
+        break;
+      }
+    }
+    if (batch == nullptr) return;
+
+    const size_t index = batch->next++;
+    if (!pool_->Submit(i, batch->problems[index])) {
+      Answer(batch, index, nullptr);
+      Retire(batch);
+      continue;
+    }
+    batch->running++;
+    running_batch_[i] = batch;
+    running_index_[i] = index;
+  }
+
+  if (pool_->live() == 0) {
+    // Nothing left to solve the remaining problems
+    const std::vector<Batch*> open(batches_);
+    for (Batch* batch : open) {
+      while (batch->next < batch->problems.size()) {
+        Answer(batch, batch->next++, nullptr);
+      }
+      Retire(batch);
+    }
+  }
+}
+
+void PlanService::Answer(Batch* batch, size_t index, const PlanResult* r) {
+  batch->done++;
+  if (batch->cancelled) return;
+
+  out_.clear();
+  if (batch->binary) {
+    PlanResult failed;
+    if (r == nullptr) {
+      failed.delta = std::numeric_limits<double>::quiet_NaN();
+      failed.a = failed.delta;
+      failed.n = 0;
+      r = &failed;
+    }
+    out_.resize(wire::kSequenceSize + wire::kMaxPlanResultSize);
+    uint8_t* p = reinterpret_cast<uint8_t*>(&out_[0]);
+    size_t n = wire::EncodeSequence(index, p);
+    n += wire::EncodePlanResult(*r, p + n);
+    out_.resize(n);
+  } else {
+    json record;
+    record["index"] = index;
+    if (r != nullptr) {
+      record["delta"] = r->delta;
+      record["a"] = r->a;
+      record["x"] = std::vector<double>(r->x, r->x + r->n);
+      record["y"] = std::vector<double>(r->y, r->y + r->n);
+    } else {
+      record["error"] = "Solve failed";
+    }
+    record.dump_to(out_);
+    out_ += '\n';
+  }
+  write_(batch->client, out_, batch->done == batch->problems.size());
+}
+
+void PlanService::Retire(Batch* batch) {
+  if (batch->running > 0 || batch->next < batch->problems.size()) return;
+  batches_.erase(std::find(batches_.begin(), batches_.end(), batch));
+  delete batch;
+}
+
+bool PlanService::ParseJson(const char* body, size_t length,
+                            std::vector<PlanProblem>* problems,
+                            std::string* error) {
+  json batch;
+  try {
+    batch = json::parse(body, body + length);
+  } catch (const std::exception& e) {
+    *error = e.what();
+    return false;
+  }
+  if (!batch.is_array()) {
+    *error = "Expected an array of problems";
+    return false;
+  }
+  if (batch.size() > kMaxProblems) {
+    *error = "More than " + std::to_string(kMaxProblems) + " problems";
+    return false;
+  }
+
+  problems->resize(batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const json& item = batch[i];
+    PlanProblem& p = (*problems)[i];
+    const std::string where = "Problem " + std::to_string(i) + ": ";
+    if (!item.is_object()) {
+      *error = where + "not an object";
+      return false;
+    }
+    auto state = item.find("state");
+    if (state == item.end() ||
+        !ReadNumbers(*state, PlanProblem::kStateSize, PlanProblem::kStateSize,
+                     p.state)) {
+      *error = where + "state must be " +
+               std::to_string(PlanProblem::kStateSize) + " numbers";
+      return false;
+    }
+    auto coeffs = item.find("coeffs");
+    if (coeffs == item.end() ||
+        !ReadNumbers(*coeffs, 1, PlanProblem::kCoeffs, p.coeffs)) {
+      *error = where + "coeffs must be 1 to " +
+               std::to_string(PlanProblem::kCoeffs) + " numbers";
+      return false;
+    }
+    auto horizon = item.find("horizon");
+    if (horizon == item.end() || !horizon->is_number_integer() ||
+        *horizon < PlanProblem::kMinHorizon ||
+        *horizon > PlanProblem::kMaxHorizon) {
+      *error = where + "horizon must be an integer from " +
+               std::to_string(PlanProblem::kMinHorizon) + " to " +
+               std::to_string(PlanProblem::kMaxHorizon);
+      return false;
+    }
+    p.horizon = *horizon;
+  }
+  return true;
+}
+
+bool PlanService::ParseBinary(const char* body, size_t length,
+                              std::vector<PlanProblem>* problems,
+                              std::string* error) {
+  const size_t count = length / wire::kPlanProblemSize;
+  if (length % wire::kPlanProblemSize != 0) {
+    *error = "Body is not a sequence of plan problem frames";
+    return false;
+  }
+  if (count > kMaxProblems) {
+    *error = "More than " + std::to_string(kMaxProblems) + " problems";
+    return false;
+  }
+
+  problems->resize(count);
+  const uint8_t* frame = reinterpret_cast<const uint8_t*>(body);
+  for (size_t i = 0; i < count; ++i, frame += wire::kPlanProblemSize) {
+    if (!wire::DecodePlanProblem(frame, wire::kPlanProblemSize,
+                                 &(*problems)[i])) {
+      *error = "Problem " + std::to_string(i) + ": invalid frame";
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,97 @@
+#ifndef PLAN_SERVICE_H
+#define PLAN_SERVICE_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "plan.h"
+#include "solver_pool.h"
+
+// Batch planning for offline analysis: a client posts a batch of planning
+// problems and gets the optimal trajectories streamed back as they
+// complete, solved by the production MPC on all cores.
+//
+// A batch is either a sequence of kPlanProblem frames (wire.h) or JSON:
+//
+//   [{"state": [x, y, psi, v, cte, epsi], "coeffs": [c0, c1, c2, c3],
+//     "horizon": 15}, ...]
+//
+// with missing higher coefficients taken as 0. Results come back in the
+// format of the batch, one record per problem in the order they complete:
+//
+//   binary  u64 index | kPlanResult frame (n = 0 if the solve failed)
+//   JSON    {"index": 0, "delta": ..., "a": ..., "x": [...], "y": [...]}
+//           or {"index": 0, "error": "..."}, one per line
+//
+// The problems of all open batches share the solver pool round-robin, so a
+// large batch does not hold up small ones. At most max_batches batches are
+// open at a time; more are turned away.
+class PlanService {
+ public:
+  static const size_t kMaxProblems = 100000;
+
+  // Receives the response to a client's batch in chunks. The last chunk
+  // ends the response.
+  typedef std::function<void(void* client, const std::string& chunk,
+                             bool last)> Writer;
+
+  PlanService(SolverPool* pool, int max_batches, Writer write);
+  ~PlanService();
+
+  // Open a batch for client from a complete request body. Returns false
+  // with a message in error if the batch is malformed or turned away.
+  bool Open(void* client, const char* body, size_t length,
+            std::string* error);
+
+  // The client went away: its problems not yet handed out are dropped.
+  void Cancel(void* client);
+
+  // The socket of worker i is readable. Returns false if the worker failed
+  // and is no longer to be watched.
+  bool OnReadable(int worker);
+
+ private:
+  struct Batch {
+    void* client;
+    bool binary;
+    std::vector<PlanProblem> problems;
+    // Next problem to hand out
+    size_t next;
+    // Problems at the workers, and problems answered
+    size_t running;
+    size_t done;
+    bool cancelled;
+  };
+
+  static bool ParseJson(const char* body, size_t length,
+                        std::vector<PlanProblem>* problems,
+                        std::string* error);
+  static bool ParseBinary(const char* body, size_t length,
+                          std::vector<PlanProblem>* problems,
+                          std::string* error);
+
+  // Hand problems to idle workers, taking turns among the open batches.
+  void Dispatch();
+  // Respond to problem index of a batch; r is null if it failed.
+  void Answer(Batch* batch, size_t index, const PlanResult* r);
+  // Forget a batch with nothing left at the workers, if it is finished.
+  void Retire(Batch* batch);
+
+  SolverPool* pool_;
+  size_t max_batches_;
+  Writer write_;
+  std::vector<Batch*> batches_;
+  // Batch to serve next in Dispatch
+  size_t turn_;
+  // Per worker: the batch and index of the problem it is solving
+  std::vector<Batch*> running_batch_;
+  std::vector<size_t> running_index_;
+  // Response chunk, reused
+  std::string out_;
+
+  PlanService(const PlanService&) = delete;
+  PlanService& operator=(const PlanService&) = delete;
+};
+
+#endif /* PLAN_SERVICE_H */
@@ -0,0 +1,52 @@
+#include "plan_tracker.h"
+#include <math.h>
+#include <algorithm>
+#include "geometry.h"
+#include "mpc_model.h"
+#include "pure_pursuit.h"
+
+void MakePlan(const Telemetry& t, const Actuation& act, const double* throttle,
+              int n_throttle, double dt, TrackedPlan* plan) {
+  plan->n = std::min(act.n_mpc, int(TrackedPlan::kMaxPoints));
+  ToGlobalFrame(act.mpc_x, act.mpc_y, plan->n, t.x, t.y, t.psi, plan->x,
+                plan->y);
+  plan->n_ref = std::min(act.n_next, int(TrackedPlan::kMaxPoints));
+  ToGlobalFrame(act.next_x, act.next_y, plan->n_ref, t.x, t.y, t.psi,
+                plan->ref_x, plan->ref_y);
+  plan->n_throttle = std::min(n_throttle, int(TrackedPlan::kMaxPoints));
+  std::copy(throttle, throttle + plan->n_throttle, plan->throttle);
+  plan->dt = dt;
+}
+
+bool TrackPlan(const TrackedPlan& plan, const Telemetry& t, double age,
+               double latency, Actuation* out) {
+  if (plan.n < 2 || plan.n_throttle == 0 || age < 0 ||
+      age >= (plan.n - 1) * plan.dt) {
+    return false;
+  }
+
+  // Displayed relative to the car as it is
+  ToLocalFrame(plan.x, plan.y, plan.n, t.x, t.y, t.psi, out->mpc_x,
+               out->mpc_y);
+  out->n_mpc = plan.n;
+  ToLocalFrame(plan.ref_x, plan.ref_y, plan.n_ref, t.x, t.y, t.psi,
+               out->next_x, out->next_y);
+  out->n_next = plan.n_ref;
+
+  // Steered from where the car will be once the actuation takes effect,
+  // by the same kinematic update as the controller's
+  const double v = t.speed * kMphToMps;
+  const double delta = -t.steering_angle;
+  const double x = t.x + v * cos(t.psi) * latency;
+  const double y = t.y + v * sin(t.psi) * latency;
+  const double psi = t.psi + v * delta / Lf * latency;
+  double lx[TrackedPlan::kMaxPoints];
+  double ly[TrackedPlan::kMaxPoints];
+  ToLocalFrame(plan.x, plan.y, plan.n, x, y, psi, lx, ly);
+
+  // Steering angle is negative in rotated coordinates
+  out->steering_angle = -PursuitSteering(lx, ly, plan.n, t.speed);
+  const int step = std::min(int(age / plan.dt), plan.n_throttle - 1);
+  out->throttle = plan.throttle[step];
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef PLAN_TRACKER_H
+#define PLAN_TRACKER_H
+
+#include <chrono>
+#include "telemetry.h"
+
+// The inner loop of two-rate control: the MPC solves now and then, and in
+// between every telemetry frame is answered by tracking its last plan,
+// which costs a fraction of a solve.
+
+// The MPC's plan for a car, in world coordinates so that it can be tracked
+// from any later pose.
+struct TrackedPlan {
+  static const int kMaxPoints = Actuation::kMaxPathPoints;
+
+  // Predicted trajectory, first n are valid
+  int n;
+  double x[kMaxPoints];
+  double y[kMaxPoints];
+  // Reference path displayed with it
+  int n_ref;
+  double ref_x[kMaxPoints];
+  double ref_y[kMaxPoints];
+  // Nominal throttle for each step of dt seconds
+  int n_throttle;
+  double throttle[kMaxPoints];
+  double dt;
+  // Arrival of the telemetry it was made for
+  std::chrono::steady_clock::time_point made;
+};
+
+// Record the MPC's answer act to telemetry t as a plan, with the throttle
+// it planned for each step of dt seconds.
+void MakePlan(const Telemetry& t, const Actuation& act, const double* throttle,
+              int n_throttle, double dt, TrackedPlan* plan);
+
+// Answer telemetry t, arriving age seconds after the plan's, by pure
+// pursuit along the predicted trajectory and the nominal throttle of the
+// step at hand. The car is first moved ahead by the actuation latency.
+// Returns false if the plan is empty or has run out.
+bool TrackPlan(const TrackedPlan& plan, const Telemetry& t, double age,
+               double latency, Actuation* out);
+
+#endif /* PLAN_TRACKER_H */
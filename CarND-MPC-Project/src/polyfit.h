@@ -0,0 +1,98 @@
+#ifndef POLYFIT_H
+#define POLYFIT_H
+
+#include <cassert>
+#include <cmath>
+#include "Eigen-3.3/Eigen/Core"
+#include "Eigen-3.3/Eigen/QR"
+
+// Evaluate a polynomial (coefficients in increasing order) using Horner's rule.
+template <typename Derived>
+inline double polyeval(const Eigen::MatrixBase<Derived>& coeffs, double x) {
+  double result = 0.0;
+  for (int i = int(coeffs.size()) - 1; i >= 0; --i) {
+    result = result * x + coeffs[i];
+  }
+  return result;
+}
+
+// Evaluate the first derivative of a polynomial, also by Horner's rule.
+// Used for the heading of the reference path (epsi).
+template <typename Derived>
+inline double polyderiv(const Eigen::MatrixBase<Derived>& coeffs, double x) {
+  double result = 0.0;
+  for (int i = int(coeffs.size()) - 1; i >= 1; --i) {
+    result = result * x + i * coeffs[i];
+  }
+  return result;
+}
+
+// Least-squares polynomial fit of order `Degree` to at most `MaxPoints`
+// samples. All storage is sized at compile time, so fitting never touches
+// the heap.
+//
+// Besides the plain fit there is a prefactored fit: when the same x samples
+// are fitted repeatedly, Prefactor() stores the least-squares projector once
+// and FitPrefactored() reduces every later fit to a small matrix-vector
+// product.
+template <int Degree, int MaxPoints>
+class PolyFit {
+ public:
+  static const int kCoeffs = Degree + 1;
+
+  typedef Eigen::Matrix<double, kCoeffs, 1> Coeffs;
+
+  PolyFit() : n_prefactored_(0) {}
+
+  // Fit y = f(x) over the first `n` samples.
+  Coeffs Fit(const double* x, const double* y, int n) {
+    assert(n > Degree && n <= MaxPoints);
+    Basis A(n, kCoeffs);
+    FillBasis(x, n, A);
+    qr_.compute(A);
+    return qr_.solve(Eigen::Map<const Samples>(y, n));
+  }
+
+  // Factor the basis for the x samples and keep the resulting projector
+  // so that later fits over the same samples skip the decomposition.
+  void Prefactor(const double* x, int n) {
+    assert(n > Degree && n <= MaxPoints);
+    Basis A(n, kCoeffs);
+    FillBasis(x, n, A);
+    qr_.compute(A);
+    projector_ = qr_.solve(Square::Identity(n, n));
+    n_prefactored_ = n;
+  }
+
+  // Fit new y values over the samples given to Prefactor().
+  Coeffs FitPrefactored(const double* y) const {
+    assert(n_prefactored_ > 0);
+    return projector_ * Eigen::Map<const Samples>(y, n_prefactored_);
+  }
+
+ private:
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor,
+                        MaxPoints, 1> Samples;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, kCoeffs, Eigen::ColMajor,
+                        MaxPoints, kCoeffs> Basis;
+  typedef Eigen::Matrix<double, kCoeffs, Eigen::Dynamic, Eigen::ColMajor,
+                        kCoeffs, MaxPoints> Projector;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                        Eigen::ColMajor, MaxPoints, MaxPoints> Square;
+
+  // Vandermonde matrix: A(j, i) = x[j]^i
+  static void FillBasis(const double* x, int n, Basis& A) {
+    for (int j = 0; j < n; ++j) {
+      A(j, 0) = 1.0;
+      for (int i = 0; i < Degree; ++i) {
+        A(j, i + 1) = A(j, i) * x[j];
+      }
+    }
+  }
+
+  Eigen::HouseholderQR<Basis> qr_;
+  Projector projector_;
+  int n_prefactored_;
+};
+
+#endif /* POLYFIT_H */
@@ -0,0 +1,76 @@
+#include "pure_pursuit.h"
+#include <math.h>
+#include <algorithm>
+#include "geometry.h"
+#include "mpc_model.h"
+
+// Steering limit of the car (radians), 25 degrees
+const double kMaxSteering = 0.436332;
+
+// Lookahead: this much time ahead at the current speed, but at least
+// kMinLookahead meters.
+const double kLookaheadTime = 0.6;
+const double kMinLookahead = 8.0;
+
+// Speed held (mph) and throttle per mph of speed error.
+const double kSpeed = 40.0;
+const double kSpeedGain = 0.1;
+
+bool LookaheadPoint(const double* x, const double* y, int n, double distance,
+                    double* px, double* py) {
+  if (n == 0) return false;
+  const double d2 = distance * distance;
+  double x0 = 0;
+  double y0 = 0;
+  for (int i = 0; i < n; ++i) {
+    if (x[i] * x[i] + y[i] * y[i] >= d2) {
+      // The circle of radius distance crosses the segment from (x0, y0)
+      const double dx = x[i] - x0;
+      const double dy = y[i] - y0;
+      const double a = dx * dx + dy * dy;
+      const double b = 2 * (x0 * dx + y0 * dy);
+      const double c = x0 * x0 + y0 * y0 - d2;
+      double s = a > 0 ? (-b + sqrt(std::max(0.0, b * b - 4 * a * c))) / (2 * a)
+                       : 1;
+      s = std::min(1.0, std::max(0.0, s));
+      *px = x0 + s * dx;
+      *py = y0 + s * dy;
+      return true;
+    }
+    x0 = x[i];
+    y0 = y[i];
+  }
+  *px = x[n - 1];
+  *py = y[n - 1];
+  return true;
+}
+
+double PursuitSteering(const double* x, const double* y, int n,
+                       double speed) {
+  // Waypoints behind the car are not pursued
+  int first = 0;
+  while (first < n && x[first] < 0) ++first;
+
+  const double lookahead =
+      std::max(kMinLookahead, kLookaheadTime * speed * kMphToMps);
+  double px;
+  double py;
+  if (!LookaheadPoint(x + first, y + first, n - first, lookahead, &px, &py)) {
+    return 0;
+  }
+  // Steering angle of the kinematic model for that curvature
+  const double delta = Lf * ArcCurvature(px, py);
+  return std::min(kMaxSteering, std::max(-kMaxSteering, delta));
+}
+
+void PurePursuit(const Telemetry& t, Actuation* out) {
+  const int n = std::min(t.n, int(Actuation::kMaxPathPoints));
+  ToLocalFrame(t.ptsx, t.ptsy, n, t.x, t.y, t.psi, out->next_x, out->next_y);
+  out->n_next = n;
+  out->n_mpc = 0;
+
+  // Steering angle is negative in rotated coordinates
+  out->steering_angle = -PursuitSteering(out->next_x, out->next_y, n, t.speed);
+  out->throttle =
+      std::min(1.0, std::max(-1.0, kSpeedGain * (kSpeed - t.speed)));
+}
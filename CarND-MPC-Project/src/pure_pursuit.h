@@ -0,0 +1,33 @@
+#ifndef PURE_PURSUIT_H
+#define PURE_PURSUIT_H
+
+#include "telemetry.h"
+
+// Geometric path tracking. Points are in the car frame: origin at the car,
+// x-axis along its heading.
+
+// Curvature of the arc that leaves the car along its heading and passes
+// through (x, y), the pure pursuit steering law.
+inline double ArcCurvature(double x, double y) {
+  const double d2 = x * x + y * y;
+  return d2 > 0 ? 2 * y / d2 : 0;
+}
+
+// The first point of the polyline (x, y) at the given distance from the
+// car, interpolated within its segment, or the last point if none is that
+// far. Returns false for an empty polyline.
+bool LookaheadPoint(const double* x, const double* y, int n, double distance,
+                    double* px, double* py);
+
+// Steering angle (radians, positive to the left, within the steering
+// limit) that pursues the polyline (x, y) at a lookahead distance for the
+// given speed (mph). Points behind the car are skipped.
+double PursuitSteering(const double* x, const double* y, int n, double speed);
+
+// A trivial controller that needs no solver, the fallback under overload:
+// steers by pure pursuit toward the waypoints at a speed dependent
+// lookahead distance and holds a moderate speed with a proportional
+// throttle. Only the reference path is displayed.
+void PurePursuit(const Telemetry& t, Actuation* out);
+
+#endif /* PURE_PURSUIT_H */
@@ -0,0 +1,111 @@
+#include "shm_channel.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include "spsc_ring.h"
+
+// Written last by the creator; an attaching side checks it.
+const uint32_t kShmMagic = 0x4d504353;  // "SCPM"
+const uint32_t kShmVersion = 1;
+
+struct ShmChannel::Layout {
+  SpscRing<Telemetry, 8> telemetry;
+  SpscRing<Actuation, 8> actuation;
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+};
+
+static std::string ShmName(int vehicle) {
+  return "/mpc-vehicle-" + std::to_string(vehicle);
+}
+
+ShmChannel::ShmChannel()
+    : shm_(nullptr),
+      owner_(false),
+      vehicle_(-1),
+      skipped_(0),
+      invalid_(0) {}
+
+ShmChannel::~ShmChannel() { Close(); }
+
+bool ShmChannel::Create(int vehicle) { return Open(vehicle, true); }
+
+bool ShmChannel::Attach(int vehicle) { return Open(vehicle, false); }
+
+bool ShmChannel::Open(int vehicle, bool create) {
+  Close();
+  const std::string name = ShmName(vehicle);
+  if (create) {
+    // Start from scratch; a stale channel may be left from a crash
+    shm_unlink(name.c_str());
+  }
+  int fd = shm_open(name.c_str(), create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR,
+                    0600);
+  if (fd < 0) return false;
+  if (create && ftruncate(fd, sizeof(Layout)) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void* mem = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    if (create) shm_unlink(name.c_str());
+    return false;
+  }
+
+  shm_ = static_cast<Layout*>(mem);
+  owner_ = create;
+  vehicle_ = vehicle;
+  if (create) {
+    // The mapping is zero-filled, which is a valid state for the atomics
+    shm_->telemetry.Init();
+    shm_->actuation.Init();
+    shm_->version = kShmVersion;
+    shm_->magic.store(kShmMagic, std::memory_order_release);
+  } else if (shm_->magic.load(std::memory_order_acquire) != kShmMagic ||
+             shm_->version != kShmVersion) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void ShmChannel::Close() {
+  if (!shm_) return;
+  munmap(shm_, sizeof(Layout));
+  if (owner_) shm_unlink(ShmName(vehicle_).c_str());
+  shm_ = nullptr;
+  owner_ = false;
+}
+
+bool ShmChannel::SendTelemetry(const Telemetry& t) {
+  return shm_->telemetry.Push(t);
+}
+
+bool ShmChannel::SendActuation(const Actuation& a) {
+  return shm_->actuation.Push(a);
+}
+
+bool ShmChannel::ReceiveTelemetry(Telemetry* t, int timeout_ms) {
+  if (!shm_->telemetry.Wait(timeout_ms)) return false;
+  // Keep only the newest frame
+  while (shm_->telemetry.Size() > 1) {
+    shm_->telemetry.Pop(t);
+    skipped_++;
+  }
+  if (!shm_->telemetry.Pop(t)) return false;
+  // The simulator fills the frame, so its count is not to be trusted
+  if (t->n < Telemetry::kMinWaypoints || t->n > Telemetry::kMaxWaypoints) {
+    invalid_++;
+    return false;
+  }
+  return true;
+}
+
+bool ShmChannel::ReceiveActuation(Actuation* a, int timeout_ms) {
+  return shm_->actuation.Wait(timeout_ms) && shm_->actuation.Pop(a);
+}
@@ -0,0 +1,59 @@
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <cstdint>
+#include "telemetry.h"
+
+// Shared-memory transport for a simulator running on the same host.
+//
+// Each vehicle gets a POSIX shared memory object ("/mpc-vehicle-<id>")
+// holding two single-producer single-consumer rings: telemetry from the
+// simulator to the controller and actuations back. Frames are the plain
+// Telemetry and Actuation structs, so there is no framing or encoding at
+// all, and a blocked reader is woken with a futex.
+//
+// The controller creates the channel, the simulator attaches to it.
+class ShmChannel {
+ public:
+  ShmChannel();
+  ~ShmChannel();
+
+  // Controller side: create (or re-create) the channel of a vehicle.
+  bool Create(int vehicle);
+  // Simulator side: attach to a channel created by the controller.
+  bool Attach(int vehicle);
+
+  // Queue a frame for the other side. Returns false if its ring is full.
+  bool SendTelemetry(const Telemetry& t);
+  bool SendActuation(const Actuation& a);
+
+  // Wait up to timeout_ms (forever if < 0) for the next frame.
+  // ReceiveTelemetry returns the newest frame and skips older ones that
+  // queued up meanwhile; they are stale for control. A newest frame with
+  // fewer than kMinWaypoints or more than kMaxWaypoints waypoints is
+  // dropped, as the binary decoder drops it.
+  bool ReceiveTelemetry(Telemetry* t, int timeout_ms);
+  bool ReceiveActuation(Actuation* a, int timeout_ms);
+
+  // Telemetry frames skipped as stale so far.
+  uint64_t skipped() const { return skipped_; }
+  // Telemetry frames dropped for their waypoint count so far.
+  uint64_t invalid() const { return invalid_; }
+
+ private:
+  struct Layout;
+
+  bool Open(int vehicle, bool create);
+  void Close();
+
+  Layout* shm_;
+  bool owner_;
+  int vehicle_;
+  uint64_t skipped_;
+  uint64_t invalid_;
+
+  ShmChannel(const ShmChannel&) = delete;
+  ShmChannel& operator=(const ShmChannel&) = delete;
+};
+
+#endif /* SHM_CHANNEL_H */
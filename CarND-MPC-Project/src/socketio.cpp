@@ -0,0 +1,163 @@
+#include "socketio.h"
+#include <cmath>
+#include <cstring>
+#include "json.hpp"
+
+namespace socketio {
+
+// Longest acknowledgement id accepted, so it fits a long
+const int kMaxAckDigits = 18;
+
+static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static const char* SkipSpace(const char* c, const char* end) {
+  while (c != end && IsSpace(*c)) ++c;
+  return c;
+}
+
+static const char* TrimSpace(const char* begin, const char* end) {
+  while (end != begin && IsSpace(end[-1])) --end;
+  return end;
+}
+
+bool Decode(const char* msg, size_t length, Packet* p) {
+  const char* c = msg;
+  const char* end = msg + length;
+  p->engine = kEngineInvalid;
+  p->type = kNone;
+  p->ack_id = -1;
+  p->name = nullptr;
+  p->name_length = 0;
+  p->data = nullptr;
+  p->data_length = 0;
+
+  if (c == end || *c < '0' || *c > '6') return false;
+  p->engine = EngineType(*c++ - '0');
+  if (p->engine != kMessage) {
+    // Pings and pongs may carry probe data
+    p->data = c;
+    p->data_length = end - c;
+    return true;
+  }
+
+  if (c == end || *c < '0' || *c > '6') return false;
+  p->type = PacketType(*c++ - '0');
+
+  // Binary packets announce their number of attachments: 51-
+  if (p->type == kBinaryEvent || p->type == kBinaryAck) {
+    while (c != end && IsDigit(*c)) ++c;
+    if (c == end || *c++ != '-') return false;
+  }
+
+  // Namespace other than the default one: /nsp,
+  if (c != end && *c == '/') {
+    while (c != end && *c != ',') ++c;
+    if (c == end) return true;
+    ++c;
+  }
+
+  if (c != end && IsDigit(*c)) {
+    p->ack_id = 0;
+    for (int digits = 0; c != end && IsDigit(*c); ++digits) {
+      if (digits == kMaxAckDigits) return false;
+      p->ack_id = p->ack_id * 10 + (*c++ - '0');
+    }
+  }
+
+  if (p->type != kEvent && p->type != kBinaryEvent &&
+      p->type != kAck && p->type != kBinaryAck) {
+    p->data = c;
+    p->data_length = end - c;
+    return true;
+  }
+
+  // The arguments form a JSON array. Only its brackets and the event name
+  // are looked at, the data is left to the JSON parser.
+  c = SkipSpace(c, end);
+  end = TrimSpace(c, end);
+  if (end - c < 2 || *c != '[' || end[-1] != ']') return false;
+  c = SkipSpace(c + 1, end - 1);
+  end = TrimSpace(c, end - 1);
+
+  if (p->type == kEvent || p->type == kBinaryEvent) {
+    if (c == end || *c != '"') return false;
+    p->name = ++c;
+    while (c != end && *c != '"') {
+      if (*c == '\\' && ++c == end) return false;
+      ++c;
+    }
+    if (c == end) return false;
+    p->name_length = c - p->name;
+    c = SkipSpace(c + 1, end);
+    if (c == end) return true;
+    if (*c != ',') return false;
+    c = SkipSpace(c + 1, end);
+  }
+
+  p->data = c;
+  p->data_length = end - c;
+  return true;
+}
+
+bool IsEvent(const Packet& p, const char* name) {
+  return (p.type == kEvent || p.type == kBinaryEvent) &&
+         p.name_length == strlen(name) &&
+         memcmp(p.name, name, p.name_length) == 0;
+}
+
+bool HasData(const Packet& p) {
+  return p.data_length > 0 &&
+         !(p.data_length == 4 && memcmp(p.data, "null", 4) == 0);
+}
+
+EventWriter::EventWriter(std::string* out, const char* name)
+    : out_(out), first_(true) {
+  out_->assign("42[\"");
+  out_->append(name);
+  out_->append("\",{");
+}
+
+void EventWriter::Number(const char* key, double value, int precision) {
+  Key(key);
+  Value(value, precision);
+}
+
+void EventWriter::Array(const char* key, const double* values, int n,
+                        int precision) {
+  Key(key);
+  *out_ += '[';
+  for (int i = 0; i < n; ++i) {
+    if (i > 0) *out_ += ',';
+    Value(values[i], precision);
+  }
+  *out_ += ']';
+}
+
+void EventWriter::End() { out_->append("}]"); }
+
+void EventWriter::Key(const char* key) {
+  if (!first_) *out_ += ',';
+  first_ = false;
+  *out_ += '"';
+  out_->append(key);
+  out_->append("\":");
+}
+
+void EventWriter::Value(double value, int precision) {
+  if (!std::isfinite(value)) {
+    out_->append("null");
+    return;
+  }
+  // to_chars needs room for 32 characters
+  const size_t size = out_->size();
+  out_->resize(size + 32);
+  char* first = &(*out_)[size];
+  char* last = nlohmann::detail::dtoa::to_chars(first, value, precision);
+  out_->resize(size + (last - first));
+}
+
+}  // namespace socketio
@@ -0,0 +1,101 @@
+#ifndef SOCKETIO_H
+#define SOCKETIO_H
+
+#include <cstddef>
+#include <string>
+
+// Decoder for the Engine.IO/Socket.IO text messages the simulator sends
+// over the websocket, e.g.
+//
+//   42["telemetry",{"ptsx":[...],...}]
+//   ^^ ^           ^
+//   || event name  data
+//   |Socket.IO packet type (2 = event)
+//   Engine.IO packet type (4 = message)
+//
+// Decode makes a single pass over the raw message and copies nothing: the
+// event name and data are returned as spans of the message. EventWriter
+// goes the other way, straight into a reusable buffer.
+namespace socketio {
+
+// Engine.IO packet types, the first character of every message
+enum EngineType {
+  kEngineInvalid = -1,
+  kOpen = 0,
+  kClose = 1,
+  kPing = 2,
+  kPong = 3,
+  kMessage = 4,
+  kUpgrade = 5,
+  kNoop = 6,
+};
+
+// Socket.IO packet types, carried in Engine.IO messages
+enum PacketType {
+  kNone = -1,
+  kConnect = 0,
+  kDisconnect = 1,
+  kEvent = 2,
+  kAck = 3,
+  kError = 4,
+  kBinaryEvent = 5,
+  kBinaryAck = 6,
+};
+
+struct Packet {
+  EngineType engine;
+  // Socket.IO packet type of a kMessage, else kNone
+  PacketType type;
+  // Acknowledgement id the sender asked for, or -1
+  long ack_id;
+  // Event name, without quotes or unescaping
+  const char* name;
+  size_t name_length;
+  // Events: the arguments after the name (usually one JSON value).
+  // Acks: all arguments. Pings and pongs: their probe data.
+  // Empty if there are none.
+  const char* data;
+  size_t data_length;
+};
+
+// Decode one websocket text message. Returns false if it is malformed.
+bool Decode(const char* msg, size_t length, Packet* p);
+
+// Whether p is the event with the given name.
+bool IsEvent(const Packet& p, const char* name);
+
+// Whether p carries data other than null. The simulator sends events with
+// null data while it is driven manually.
+bool HasData(const Packet& p);
+
+// Writes an event with one object argument into a buffer, e.g.
+//
+//   EventWriter w(&buf, "steer");      // 42["steer",{
+//   w.Number("throttle", 0.3);         // "throttle":0.3
+//   w.Array("next_x", xs, n, 5);       // ,"next_x":[...]
+//   w.End();                           // }]
+//
+// The buffer is overwritten and keeps its capacity, so a reused one stops
+// allocating. Keys are written as given, without escaping. Numbers are
+// written with at most precision significant digits, or with the shortest
+// representation that reads back to the same value if precision is 0.
+class EventWriter {
+ public:
+  EventWriter(std::string* out, const char* name);
+
+  void Number(const char* key, double value, int precision = 0);
+  void Array(const char* key, const double* values, int n,
+             int precision = 0);
+  void End();
+
+ private:
+  void Key(const char* key);
+  void Value(double value, int precision);
+
+  std::string* out_;
+  bool first_;
+};
+
+}  // namespace socketio
+
+#endif /* SOCKETIO_H */
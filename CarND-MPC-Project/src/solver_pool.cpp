@@ -0,0 +1,150 @@
+#include "solver_pool.h"
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <iostream>
+#include <limits>
+#include "Eigen-3.3/Eigen/Core"
+#include "MPC.h"
+#include "wire.h"
+
+#ifndef MSG_NOSIGNAL
+// macOS: sockets are made not to raise SIGPIPE with SO_NOSIGPIPE instead
+#define MSG_NOSIGNAL 0
+#endif
+
+// Read or write exactly n bytes, retrying short transfers and interrupts.
+static bool ReadFull(int fd, uint8_t* buf, size_t n) {
+  while (n > 0) {
+    ssize_t r = read(fd, buf, n);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return false;
+    buf += r;
+    n -= size_t(r);
+  }
+  return true;
+}
+
+static bool WriteFull(int fd, const uint8_t* buf, size_t n) {
+  while (n > 0) {
+    ssize_t r = send(fd, buf, n, MSG_NOSIGNAL);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return false;
+    buf += r;
+    n -= size_t(r);
+  }
+  return true;
+}
+
+SolverPool::SolverPool() : live_(0) {}
+
+SolverPool::~SolverPool() {
+  for (int i = 0; i < size(); ++i) {
+    if (fds_[i] >= 0) close(fds_[i]);
+  }
+  // The workers see the end of their socket and exit
+  for (pid_t pid : pids_) waitpid(pid, nullptr, 0);
+}
+
+bool SolverPool::Start(int workers) {
+  for (int i = 0; i < workers; ++i) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return false;
+#ifdef SO_NOSIGPIPE
+    const int one = 1;
+    setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+    setsockopt(sv[1], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    pid_t pid = fork();
+    if (pid < 0) {
+      close(sv[0]);
+      close(sv[1]);
+      return false;
+    }
+    if (pid == 0) {
+      close(sv[0]);
+      for (int fd : fds_) close(fd);
+      Work(sv[1]);
+      _exit(0);
+    }
+    close(sv[1]);
+    fds_.push_back(sv[0]);
+    pids_.push_back(pid);
+    busy_.push_back(false);
+    live_++;
+  }
+  return true;
+}
+
+bool SolverPool::Submit(int i, const PlanProblem& p) {
+  uint8_t frame[wire::kPlanProblemSize];
+  size_t n = wire::EncodePlanProblem(p, frame);
+  if (!WriteFull(fds_[i], frame, n)) {
+    Fail(i);
+    return false;
+  }
+  busy_[i] = true;
+  return true;
+}
+
+bool SolverPool::Receive(int i, PlanResult* r) {
+  uint8_t frame[wire::kMaxPlanResultSize];
+  const size_t head = wire::kPlanResultHeadSize;
+  if (!ReadFull(fds_[i], frame, head)) {
+    Fail(i);
+    return false;
+  }
+  const size_t size = wire::PlanResultSize(frame, head);
+  if (size > sizeof(frame) || !ReadFull(fds_[i], frame + head, size - head) ||
+      !wire::DecodePlanResult(frame, size, r)) {
+    Fail(i);
+    return false;
+  }
+  busy_[i] = false;
+  return true;
+}
+
+void SolverPool::Fail(int i) {
+  std::cerr << "Solver process " << pids_[i] << " failed" << std::endl;
+  close(fds_[i]);
+  fds_[i] = -1;
+  busy_[i] = false;
+  live_--;
+  kill(pids_[i], SIGKILL);
+}
+
+// Worker process: solve problems until the pool goes away.
+void SolverPool::Work(int fd) {
+  MPC mpc;
+  MPCWorkspace workspace;
+  SolveResult result;
+  MPCState state;
+  MPCCoeffs coeffs;
+  uint8_t frame[wire::kMaxPlanResultSize];
+  PlanProblem p;
+  PlanResult r;
+  while (ReadFull(fd, frame, wire::kPlanProblemSize)) {
+    if (!wire::DecodePlanProblem(frame, wire::kPlanProblemSize, &p)) break;
+    for (int i = 0; i < PlanProblem::kStateSize; ++i) state[i] = p.state[i];
+    for (int i = 0; i < PlanProblem::kCoeffs; ++i) coeffs[i] = p.coeffs[i];
+
+    if (mpc.Solve(state, coeffs, &workspace, &result, size_t(p.horizon))) {
+      r.delta = result.steering;
+      r.a = result.throttle;
+      r.n = result.n;
+      for (int i = 0; i < r.n; ++i) {
+        r.x[i] = result.x[i];
+        r.y[i] = result.y[i];
+      }
+    } else {
+      // No trajectory for a solve that did not converge
+      r.delta = std::numeric_limits<double>::quiet_NaN();
+      r.a = r.delta;
+      r.n = 0;
+    }
+    if (!WriteFull(fd, frame, wire::EncodePlanResult(r, frame))) break;
+  }
+  close(fd);
+}
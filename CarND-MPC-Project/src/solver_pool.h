@@ -0,0 +1,52 @@
+#ifndef SOLVER_POOL_H
+#define SOLVER_POOL_H
+
+#include <sys/types.h>
+#include <vector>
+#include "plan.h"
+
+// Worker processes solving planning problems, for offline batches.
+//
+// Ipopt's default linear solver (MUMPS) keeps global state and is not
+// thread-safe, so concurrent solves need processes of their own, each with
+// its own MPC. A worker takes one problem at a time as a wire frame over a
+// socket pair and writes back the result. Workers exit once the pool closes
+// its end, including when the server dies.
+class SolverPool {
+ public:
+  SolverPool();
+  ~SolverPool();
+
+  // Fork the workers. Call before any thread is started: fork copies only
+  // the calling thread.
+  bool Start(int workers);
+
+  int size() const { return int(fds_.size()); }
+  // Workers that have not failed
+  int live() const { return live_; }
+
+  // Socket of worker i, readable once its result is ready; -1 after the
+  // worker failed.
+  int fd(int i) const { return fds_[i]; }
+  bool idle(int i) const { return fds_[i] >= 0 && !busy_[i]; }
+
+  // Hand a problem to idle worker i.
+  bool Submit(int i, const PlanProblem& p);
+  // Take the result of worker i once its socket is readable. Returns false
+  // if the worker failed; it is then shut down for good.
+  bool Receive(int i, PlanResult* r);
+
+ private:
+  static void Work(int fd);
+  void Fail(int i);
+
+  std::vector<int> fds_;
+  std::vector<pid_t> pids_;
+  std::vector<bool> busy_;
+  int live_;
+
+  SolverPool(const SolverPool&) = delete;
+  SolverPool& operator=(const SolverPool&) = delete;
+};
+
+#endif /* SOLVER_POOL_H */
@@ -0,0 +1,121 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "rings in shared memory need address-free atomics");
+
+// Block while *word == expected, for at most timeout_ms (forever if < 0).
+// Returns early on a wake-up, a signal or a spurious wake-up, so callers
+// re-check their condition. Works across processes sharing the word.
+inline void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+                      int timeout_ms) {
+#ifdef __linux__
+  struct timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+          timeout_ms < 0 ? nullptr : &ts, nullptr, 0);
+#else
+  // No futex: poll instead
+  (void)word;
+  (void)expected;
+  (void)timeout_ms;
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+#endif
+}
+
+// Wake all threads blocked in FutexWait on word.
+inline void FutexWake(std::atomic<uint32_t>* word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX,
+          nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+
+// Lock-free single-producer single-consumer ring of Capacity plain structs.
+// It holds no pointers, so it can live in memory shared between processes;
+// Init() must run once before either side uses it.
+//
+// The consumer can block in Wait() until an element arrives. The producer
+// only pays for the wake-up system call while the consumer is asleep.
+template <typename T, uint32_t Capacity>
+struct SpscRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "elements are copied as raw bytes");
+
+  void Init() {
+    head.store(0);
+    tail.store(0);
+    sleeping.store(0);
+  }
+
+  // Producer: append v, or return false if the ring is full.
+  bool Push(const T& v) {
+    const uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == Capacity) return false;
+    slots[h & (Capacity - 1)] = v;
+    head.store(h + 1, std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_seq_cst)) FutexWake(&head);
+    return true;
+  }
+
+  // Consumer: take the oldest element, or return false if the ring is empty.
+  bool Pop(T* v) {
+    const uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) return false;
+    *v = slots[t & (Capacity - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: number of elements ready to pop.
+  uint32_t Size() const {
+    return head.load(std::memory_order_acquire) -
+           tail.load(std::memory_order_relaxed);
+  }
+
+  // Consumer: wait until the ring is non-empty, for at most timeout_ms
+  // (forever if < 0). Spins briefly before going to sleep.
+  bool Wait(int timeout_ms) {
+    const uint32_t t = tail.load(std::memory_order_relaxed);
+    for (int i = 0; i < kSpins; ++i) {
+      if (head.load(std::memory_order_acquire) != t) return true;
+    }
+    if (timeout_ms == 0) return false;
+
+    // Announce the sleep before the last check, so that a producer either
+    // sees the flag or its element is seen here.
+    sleeping.store(1, std::memory_order_seq_cst);
+    const uint32_t h = head.load(std::memory_order_seq_cst);
+    if (h == t) FutexWait(&head, h, timeout_ms);
+    sleeping.store(0, std::memory_order_relaxed);
+    return head.load(std::memory_order_acquire) != t;
+  }
+
+  static const int kSpins = 1000;
+
+  // Producer and consumer indices on separate cache lines
+  alignas(64) std::atomic<uint32_t> head;
+  alignas(64) std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> sleeping;
+  alignas(64) T slots[Capacity];
+};
+
+#endif /* SPSC_RING_H */
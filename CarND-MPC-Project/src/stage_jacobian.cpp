@@ -0,0 +1,35 @@
+#include "stage_jacobian.h"
+#include "Eigen-3.3/unsupported/Eigen/AutoDiff"
+#include "mpc_model.h"
+
+// A value and its derivatives by the variables of a stage
+typedef Eigen::AutoDiffScalar<Eigen::Matrix<double, kStageSize, 1>> Dual;
+
+void StageJacobians::Evaluate(const Eigen::Vector4d& coeffs,
+                              Integrator integrator, double dt,
+                              size_t horizon, const double* vars) {
+  const Layout layout(horizon);
+  stages_ = horizon - 2;
+  if (jacobians_.size() < stages_) {
+    next_.resize(stages_);
+    jacobians_.resize(stages_);
+  }
+
+  const size_t starts[kStageSize] = {
+      layout.x_start,   layout.y_start,     layout.psi_start,
+      layout.v_start,   layout.cte_start,   layout.epsi_start,
+      layout.delta_start, layout.a_start};
+  for (size_t t = 0; t < stages_; ++t) {
+    // Seed each variable with its unit direction
+    Dual in[kStageSize];
+    for (int i = 0; i < kStageSize; ++i) {
+      in[i] = Dual(vars[starts[i] + t], kStageSize, i);
+    }
+    Dual out[kStateSize];
+    Propagate(coeffs, integrator, dt, in, out);
+    for (int i = 0; i < kStateSize; ++i) {
+      next_[t](i) = out[i].value();
+      jacobians_[t].row(i) = out[i].derivatives().transpose();
+    }
+  }
+}
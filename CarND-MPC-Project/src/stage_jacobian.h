@@ -0,0 +1,41 @@
+#ifndef STAGE_JACOBIAN_H
+#define STAGE_JACOBIAN_H
+
+#include <vector>
+#include "Eigen-3.3/Eigen/Core"
+#include "integrator.h"
+
+// Derivatives of the MPC's dynamics constraints stage by stage in forward
+// mode, instead of taping the whole problem as CppAD does. A stage maps
+// its 8 variables, the state and the actuations, to the next state, so its
+// Jacobian is a dense 6x8 matrix: it is computed with fixed-size
+// AutoDiffScalar, on the stack and without a tape.
+class StageJacobians {
+ public:
+  typedef Eigen::Matrix<double, 6, 1> State;
+  typedef Eigen::Matrix<double, 6, 8> Jacobian;
+
+  StageJacobians() : stages_(0) {}
+
+  // Evaluate the stages of a horizon of the given number of steps (at
+  // least 3) at `vars`, laid out as the MPC lays them out. The buffers are
+  // reused, so only a longer horizon than before allocates.
+  void Evaluate(const Eigen::Vector4d& coeffs, Integrator integrator,
+                double dt, size_t horizon, const double* vars);
+
+  // Stages evaluated: those the solver constrains, all but the last two
+  // states of the horizon.
+  size_t stages() const { return stages_; }
+
+  // The state stage t ends in by the model, and its derivatives by the
+  // variables of the stage.
+  const State& next(size_t t) const { return next_[t]; }
+  const Jacobian& jacobian(size_t t) const { return jacobians_[t]; }
+
+ private:
+  size_t stages_;
+  std::vector<State, Eigen::aligned_allocator<State>> next_;
+  std::vector<Jacobian, Eigen::aligned_allocator<Jacobian>> jacobians_;
+};
+
+#endif /* STAGE_JACOBIAN_H */
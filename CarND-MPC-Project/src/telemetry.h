@@ -0,0 +1,44 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+// Messages between the simulator and the controller, independent of the
+// transport. Both are plain structs with fixed capacity, so every wire
+// format decodes into them in place.
+
+// One frame of simulator telemetry in the simulator's conventions: global
+// coordinates, speed in mph, steering angle positive to the right.
+struct Telemetry {
+  static const int kMaxWaypoints = 16;
+  // The reference path is a cubic fit through the waypoints
+  static const int kMinWaypoints = 4;
+
+  double x;
+  double y;
+  double psi;
+  double speed;
+  double steering_angle;
+  double throttle;
+  // Waypoints of the reference path, first n are valid, at least
+  // kMinWaypoints
+  int n;
+  double ptsx[kMaxWaypoints];
+  double ptsy[kMaxWaypoints];
+};
+
+// The controller's answer to one telemetry frame: the actuations plus the
+// reference path (yellow) and the predicted trajectory (green) to display,
+// both in the car frame.
+struct Actuation {
+  static const int kMaxPathPoints = 32;
+
+  double steering_angle;
+  double throttle;
+  int n_next;
+  double next_x[kMaxPathPoints];
+  double next_y[kMaxPathPoints];
+  int n_mpc;
+  double mpc_x[kMaxPathPoints];
+  double mpc_y[kMaxPathPoints];
+};
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,142 @@
+#include "udp_channel.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include "wire.h"
+
+static bool SameAddress(const sockaddr_in& a, const sockaddr_in& b) {
+  return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+UdpChannel::UdpChannel()
+    : fd_(-1), connected_(false), have_peer_(false), last_seq_(0),
+      have_seq_(false) {
+  memset(&peer_, 0, sizeof(peer_));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+UdpChannel::~UdpChannel() {
+  if (fd_ >= 0) close(fd_);
+}
+
+bool UdpChannel::Bind(int port) {
+  fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) return false;
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(uint16_t(port));
+  return bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+}
+
+bool UdpChannel::Connect(const char* host, int port) {
+  fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) return false;
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* res;
+  if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &res) != 0) {
+    return false;
+  }
+  connected_ = connect(fd_, res->ai_addr, res->ai_addrlen) == 0;
+  freeaddrinfo(res);
+  return connected_;
+}
+
+bool UdpChannel::Send(size_t size) {
+  ssize_t n;
+  if (connected_) {
+    n = send(fd_, out_, size, 0);
+  } else if (have_peer_) {
+    n = sendto(fd_, out_, size, 0, reinterpret_cast<const sockaddr*>(&peer_),
+               sizeof(peer_));
+  } else {
+    return false;
+  }
+  return n == ssize_t(size);
+}
+
+bool UdpChannel::SendTelemetry(uint64_t seq, const Telemetry& t) {
+  size_t n = wire::EncodeSequence(seq, out_);
+  n += wire::EncodeTelemetry(t, out_ + n);
+  return Send(n);
+}
+
+bool UdpChannel::SendActuation(uint64_t seq, const Actuation& a) {
+  size_t n = wire::EncodeSequence(seq, out_);
+  n += wire::EncodeActuation(a, out_ + n);
+  return Send(n);
+}
+
+size_t UdpChannel::ReceiveNewest(uint16_t type, int timeout_ms, uint64_t* seq,
+                                 const uint8_t** frame) {
+  static_assert(wire::kSequenceSize + wire::kMaxFrameSize <= kMaxDatagram,
+                "datagram buffers too small");
+  pollfd pfd;
+  pfd.fd = fd_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+
+  // Drain everything queued, keeping the newest frame
+  int newest = -1;
+  size_t newest_size = 0;
+  int slot = 0;
+  while (true) {
+    sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    ssize_t n = recvfrom(fd_, in_[slot], kMaxDatagram, MSG_DONTWAIT,
+                         reinterpret_cast<sockaddr*>(&from), &from_len);
+    if (n < 0) break;
+    stats_.received++;
+
+    uint64_t s;
+    const uint8_t* body = in_[slot] + wire::kSequenceSize;
+    if (!wire::DecodeSequence(in_[slot], size_t(n), &s) ||
+        wire::PeekType(body, size_t(n) - wire::kSequenceSize) != type) {
+      stats_.invalid++;
+      continue;
+    }
+    if (!connected_ && (!have_peer_ || !SameAddress(from, peer_))) {
+      // A new sender starts its own sequence
+      peer_ = from;
+      have_peer_ = true;
+      have_seq_ = false;
+    }
+    if (have_seq_ && s <= last_seq_) {
+      stats_.stale++;
+      continue;
+    }
+    if (newest >= 0) stats_.stale++;  // superseded by this one
+    last_seq_ = s;
+    have_seq_ = true;
+    *seq = s;
+    newest = slot;
+    newest_size = size_t(n) - wire::kSequenceSize;
+    slot = 1 - slot;
+  }
+  if (newest < 0) return 0;
+  *frame = in_[newest] + wire::kSequenceSize;
+  return newest_size;
+}
+
+bool UdpChannel::ReceiveTelemetry(Telemetry* t, uint64_t* seq,
+                                  int timeout_ms) {
+  const uint8_t* frame;
+  size_t n = ReceiveNewest(wire::kTelemetry, timeout_ms, seq, &frame);
+  return n > 0 && wire::DecodeTelemetry(frame, n, t);
+}
+
+bool UdpChannel::ReceiveActuation(Actuation* a, uint64_t* seq,
+                                  int timeout_ms) {
+  const uint8_t* frame;
+  size_t n = ReceiveNewest(wire::kActuation, timeout_ms, seq, &frame);
+  return n > 0 && wire::DecodeActuation(frame, n, a);
+}
@@ -0,0 +1,73 @@
+#ifndef UDP_CHANNEL_H
+#define UDP_CHANNEL_H
+
+#include <netinet/in.h>
+#include <cstdint>
+#include "telemetry.h"
+
+// UDP transport for sensor-rate control.
+//
+// Over TCP a delayed frame holds up every frame behind it. Here each
+// datagram carries one sequence-numbered binary frame (see wire.h) and
+// stands on its own: a receiver keeps only the newest frame and drops
+// anything older than what it has already seen. The controller echoes the
+// telemetry sequence number in its actuation reply.
+//
+// The controller binds a port, the simulator connects to it. Replies go to
+// the sender of the last accepted telemetry frame.
+class UdpChannel {
+ public:
+  struct Stats {
+    uint64_t received;
+    // Dropped for arriving behind a newer frame
+    uint64_t stale;
+    // Not a valid frame of the expected type
+    uint64_t invalid;
+  };
+
+  UdpChannel();
+  ~UdpChannel();
+
+  // Controller side: receive on the given port.
+  bool Bind(int port);
+  // Simulator side: talk to the controller at host:port.
+  bool Connect(const char* host, int port);
+
+  bool SendTelemetry(uint64_t seq, const Telemetry& t);
+  bool SendActuation(uint64_t seq, const Actuation& a);
+
+  // Wait up to timeout_ms (forever if < 0) for a frame newer than any
+  // received so far. Of the frames queued meanwhile only the newest is
+  // returned.
+  bool ReceiveTelemetry(Telemetry* t, uint64_t* seq, int timeout_ms);
+  bool ReceiveActuation(Actuation* a, uint64_t* seq, int timeout_ms);
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  static const size_t kMaxDatagram = 1024;
+
+  // Wait for datagrams and pick the newest valid frame of the given type.
+  // Returns the frame (after the sequence number) and its size, or 0.
+  size_t ReceiveNewest(uint16_t type, int timeout_ms, uint64_t* seq,
+                       const uint8_t** frame);
+  bool Send(size_t size);
+
+  int fd_;
+  bool connected_;
+  // Sender of the last accepted frame, where replies go
+  sockaddr_in peer_;
+  bool have_peer_;
+  // Highest sequence number accepted so far
+  uint64_t last_seq_;
+  bool have_seq_;
+  Stats stats_;
+  // Receive buffers: the newest frame so far and the one being read
+  uint8_t in_[2][kMaxDatagram];
+  uint8_t out_[kMaxDatagram];
+
+  UdpChannel(const UdpChannel&) = delete;
+  UdpChannel& operator=(const UdpChannel&) = delete;
+};
+
+#endif /* UDP_CHANNEL_H */
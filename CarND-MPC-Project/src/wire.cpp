@@ -0,0 +1,258 @@
+#include "wire.h"
+#include <cstring>
+
+namespace wire {
+
+// Little-endian stores and loads, independent of the host byte order. The
+// compilers fold these into plain moves on little-endian hosts.
+
+static uint8_t* PutU16(uint8_t* p, uint16_t v) {
+  p[0] = uint8_t(v);
+  p[1] = uint8_t(v >> 8);
+  return p + 2;
+}
+
+static uint8_t* PutU32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+  return p + 4;
+}
+
+static uint8_t* PutU64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) p[i] = uint8_t(v >> (8 * i));
+  return p + 8;
+}
+
+static uint8_t* PutF32(uint8_t* p, double v) {
+  float f = float(v);
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return PutU32(p, bits);
+}
+
+static uint8_t* PutF64(uint8_t* p, double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return PutU64(p, bits);
+}
+
+static uint16_t GetU16(const uint8_t*& p) {
+  uint16_t v = uint16_t(p[0] | (p[1] << 8));
+  p += 2;
+  return v;
+}
+
+static uint32_t GetU32(const uint8_t*& p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) v |= uint32_t(p[i]) << (8 * i);
+  p += 4;
+  return v;
+}
+
+static uint64_t GetU64(const uint8_t*& p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) v |= uint64_t(p[i]) << (8 * i);
+  p += 8;
+  return v;
+}
+
+static double GetF32(const uint8_t*& p) {
+  uint32_t bits = GetU32(p);
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+static double GetF64(const uint8_t*& p) {
+  uint64_t bits = GetU64(p);
+  double v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static uint8_t* PutHeader(uint8_t* p, uint16_t version, FrameType type) {
+  p = PutU32(p, kMagic);
+  p = PutU16(p, version);
+  return PutU16(p, type);
+}
+
+// Checks the header of a frame of the given type and skips it.
+static bool GetHeader(const uint8_t*& p, size_t len, FrameType type,
+                      uint16_t* version) {
+  if (len < kHeaderSize || GetU32(p) != kMagic) return false;
+  *version = GetU16(p);
+  return GetU16(p) == type;
+}
+
+FrameType PeekType(const uint8_t* buf, size_t len) {
+  const uint8_t* p = buf;
+  if (len < kHeaderSize || GetU32(p) != kMagic) return kInvalid;
+  GetU16(p);
+  uint16_t type = GetU16(p);
+  if (type < kHello || type > kPlanResult) return kInvalid;
+  return FrameType(type);
+}
+
+size_t EncodeHello(uint16_t version, uint8_t* buf) {
+  return PutHeader(buf, version, kHello) - buf;
+}
+
+bool DecodeHello(const uint8_t* buf, size_t len, uint16_t* version) {
+  const uint8_t* p = buf;
+  return len == kHelloSize && GetHeader(p, len, kHello, version);
+}
+
+size_t EncodeTelemetry(const Telemetry& t, uint8_t* buf) {
+  uint8_t* p = PutHeader(buf, kVersion, kTelemetry);
+  p = PutF64(p, t.x);
+  p = PutF64(p, t.y);
+  p = PutF64(p, t.psi);
+  p = PutF64(p, t.speed);
+  p = PutF64(p, t.steering_angle);
+  p = PutF64(p, t.throttle);
+  p = PutU32(p, uint32_t(t.n));
+  p = PutU32(p, 0);
+  for (int i = 0; i < t.n; ++i) p = PutF64(p, t.ptsx[i]);
+  for (int i = 0; i < t.n; ++i) p = PutF64(p, t.ptsy[i]);
+  return p - buf;
+}
+
+bool DecodeTelemetry(const uint8_t* buf, size_t len, Telemetry* t) {
+  const uint8_t* p = buf;
+  uint16_t version;
+  if (len < kHeaderSize + 6 * 8 + 8 ||
+      !GetHeader(p, len, kTelemetry, &version) || version != kVersion) {
+    return false;
+  }
+  t->x = GetF64(p);
+  t->y = GetF64(p);
+  t->psi = GetF64(p);
+  t->speed = GetF64(p);
+  t->steering_angle = GetF64(p);
+  t->throttle = GetF64(p);
+  uint32_t n = GetU32(p);
+  GetU32(p);
+  if (n < uint32_t(Telemetry::kMinWaypoints) ||
+      n > uint32_t(Telemetry::kMaxWaypoints) ||
+      len != size_t(p - buf) + 2 * 8 * n) {
+    return false;
+  }
+  t->n = int(n);
+  for (int i = 0; i < t->n; ++i) t->ptsx[i] = GetF64(p);
+  for (int i = 0; i < t->n; ++i) t->ptsy[i] = GetF64(p);
+  return true;
+}
+
+size_t EncodeActuation(const Actuation& a, uint8_t* buf) {
+  uint8_t* p = PutHeader(buf, kVersion, kActuation);
+  p = PutF64(p, a.steering_angle);
+  p = PutF64(p, a.throttle);
+  p = PutU32(p, uint32_t(a.n_next));
+  p = PutU32(p, uint32_t(a.n_mpc));
+  for (int i = 0; i < a.n_next; ++i) p = PutF32(p, a.next_x[i]);
+  for (int i = 0; i < a.n_next; ++i) p = PutF32(p, a.next_y[i]);
+  for (int i = 0; i < a.n_mpc; ++i) p = PutF32(p, a.mpc_x[i]);
+  for (int i = 0; i < a.n_mpc; ++i) p = PutF32(p, a.mpc_y[i]);
+  return p - buf;
+}
+
+bool DecodeActuation(const uint8_t* buf, size_t len, Actuation* a) {
+  const uint8_t* p = buf;
+  uint16_t version;
+  if (len < kHeaderSize + 2 * 8 + 8 ||
+      !GetHeader(p, len, kActuation, &version) || version != kVersion) {
+    return false;
+  }
+  a->steering_angle = GetF64(p);
+  a->throttle = GetF64(p);
+  uint32_t n_next = GetU32(p);
+  uint32_t n_mpc = GetU32(p);
+  if (n_next > uint32_t(Actuation::kMaxPathPoints) ||
+      n_mpc > uint32_t(Actuation::kMaxPathPoints) ||
+      len != size_t(p - buf) + 2 * 4 * (n_next + n_mpc)) {
+    return false;
+  }
+  a->n_next = int(n_next);
+  a->n_mpc = int(n_mpc);
+  for (int i = 0; i < a->n_next; ++i) a->next_x[i] = GetF32(p);
+  for (int i = 0; i < a->n_next; ++i) a->next_y[i] = GetF32(p);
+  for (int i = 0; i < a->n_mpc; ++i) a->mpc_x[i] = GetF32(p);
+  for (int i = 0; i < a->n_mpc; ++i) a->mpc_y[i] = GetF32(p);
+  return true;
+}
+
+size_t EncodePlanProblem(const PlanProblem& p, uint8_t* buf) {
+  uint8_t* q = PutHeader(buf, kVersion, kPlanProblem);
+  for (int i = 0; i < PlanProblem::kStateSize; ++i) q = PutF64(q, p.state[i]);
+  for (int i = 0; i < PlanProblem::kCoeffs; ++i) q = PutF64(q, p.coeffs[i]);
+  q = PutU32(q, uint32_t(p.horizon));
+  q = PutU32(q, 0);
+  return q - buf;
+}
+
+bool DecodePlanProblem(const uint8_t* buf, size_t len, PlanProblem* p) {
+  const uint8_t* q = buf;
+  uint16_t version;
+  if (len != kPlanProblemSize ||
+      !GetHeader(q, len, kPlanProblem, &version) || version != kVersion) {
+    return false;
+  }
+  for (int i = 0; i < PlanProblem::kStateSize; ++i) p->state[i] = GetF64(q);
+  for (int i = 0; i < PlanProblem::kCoeffs; ++i) p->coeffs[i] = GetF64(q);
+  uint32_t horizon = GetU32(q);
+  if (horizon < uint32_t(PlanProblem::kMinHorizon) ||
+      horizon > uint32_t(PlanProblem::kMaxHorizon)) {
+    return false;
+  }
+  p->horizon = int(horizon);
+  return true;
+}
+
+size_t EncodePlanResult(const PlanResult& r, uint8_t* buf) {
+  uint8_t* p = PutHeader(buf, kVersion, kPlanResult);
+  p = PutF64(p, r.delta);
+  p = PutF64(p, r.a);
+  p = PutU32(p, uint32_t(r.n));
+  p = PutU32(p, 0);
+  for (int i = 0; i < r.n; ++i) p = PutF64(p, r.x[i]);
+  for (int i = 0; i < r.n; ++i) p = PutF64(p, r.y[i]);
+  return p - buf;
+}
+
+bool DecodePlanResult(const uint8_t* buf, size_t len, PlanResult* r) {
+  const uint8_t* p = buf;
+  uint16_t version;
+  if (len < kPlanResultHeadSize ||
+      !GetHeader(p, len, kPlanResult, &version) || version != kVersion) {
+    return false;
+  }
+  r->delta = GetF64(p);
+  r->a = GetF64(p);
+  uint32_t n = GetU32(p);
+  GetU32(p);
+  if (n > uint32_t(PlanProblem::kMaxHorizon) ||
+      len != size_t(p - buf) + 2 * 8 * n) {
+    return false;
+  }
+  r->n = int(n);
+  for (int i = 0; i < r->n; ++i) r->x[i] = GetF64(p);
+  for (int i = 0; i < r->n; ++i) r->y[i] = GetF64(p);
+  return true;
+}
+
+size_t PlanResultSize(const uint8_t* buf, size_t len) {
+  if (len < kPlanResultHeadSize) return 0;
+  const uint8_t* p = buf + kHeaderSize + 2 * 8;
+  return kPlanResultHeadSize + 2 * 8 * size_t(GetU32(p));
+}
+
+size_t EncodeSequence(uint64_t seq, uint8_t* buf) {
+  return PutU64(buf, seq) - buf;
+}
+
+bool DecodeSequence(const uint8_t* buf, size_t len, uint64_t* seq) {
+  if (len < kSequenceSize) return false;
+  *seq = GetU64(buf);
+  return true;
+}
+
+}  // namespace wire
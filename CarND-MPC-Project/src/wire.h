@@ -0,0 +1,101 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "plan.h"
+#include "telemetry.h"
+
+// Binary wire format for telemetry and actuation frames, the compact
+// alternative to the Socket.IO/JSON text protocol.
+//
+// All fields are little-endian and at fixed positions. Every frame starts
+// with an 8 byte header:
+//
+//   u32 magic "MPCW" | u16 version | u16 type
+//
+// followed by the body of its type:
+//
+//   kHello      (nothing)
+//   kTelemetry  f64 x, y, psi, speed, steering_angle, throttle
+//               u32 n, u32 reserved, f64 ptsx[n], f64 ptsy[n]
+//   kActuation  f64 steering_angle, throttle
+//               u32 n_next, u32 n_mpc,
+//               f32 next_x[n_next], next_y[n_next], mpc_x[n_mpc], mpc_y[n_mpc]
+//   kPlanProblem  f64 state[6], coeffs[4], u32 horizon, u32 reserved
+//   kPlanResult   f64 delta, a, u32 n, u32 reserved, f64 x[n], y[n]
+//
+// The display paths travel as f32; they are only drawn. Planned
+// trajectories are kept at full precision for offline analysis.
+//
+// Datagram transports (udp_channel.h) put a u64 sequence number in front
+// of every frame.
+//
+// A client opts in by sending a kHello carrying the highest version it
+// speaks. The server answers with a kHello carrying the version both sides
+// use from then on.
+namespace wire {
+
+const uint32_t kMagic = 0x5743504d;  // "MPCW"
+const uint16_t kVersion = 1;
+
+enum FrameType : uint16_t {
+  kInvalid = 0,
+  kHello = 1,
+  kTelemetry = 2,
+  kActuation = 3,
+  kPlanProblem = 4,
+  kPlanResult = 5,
+};
+
+const size_t kHeaderSize = 8;
+const size_t kHelloSize = kHeaderSize;
+const size_t kMaxTelemetrySize =
+    kHeaderSize + 6 * 8 + 8 + 2 * 8 * Telemetry::kMaxWaypoints;
+const size_t kMaxActuationSize =
+    kHeaderSize + 2 * 8 + 8 + 4 * 4 * Actuation::kMaxPathPoints;
+// Large enough for any telemetry or actuation frame
+const size_t kMaxFrameSize = kMaxActuationSize > kMaxTelemetrySize
+                                 ? kMaxActuationSize : kMaxTelemetrySize;
+const size_t kPlanProblemSize =
+    kHeaderSize + 8 * (PlanProblem::kStateSize + PlanProblem::kCoeffs) + 8;
+// Plan result frames up to their trajectory
+const size_t kPlanResultHeadSize = kHeaderSize + 2 * 8 + 8;
+const size_t kMaxPlanResultSize =
+    kPlanResultHeadSize + 2 * 8 * PlanProblem::kMaxHorizon;
+
+// Type of the frame in buf, or kInvalid if it has no valid header.
+FrameType PeekType(const uint8_t* buf, size_t len);
+
+// The encoders write at most the maximum size of their frame type and return
+// the frame size. The decoders return false unless buf holds exactly one
+// valid frame of their type. A valid telemetry frame has between
+// Telemetry::kMinWaypoints and kMaxWaypoints waypoints.
+size_t EncodeHello(uint16_t version, uint8_t* buf);
+bool DecodeHello(const uint8_t* buf, size_t len, uint16_t* version);
+
+size_t EncodeTelemetry(const Telemetry& t, uint8_t* buf);
+bool DecodeTelemetry(const uint8_t* buf, size_t len, Telemetry* t);
+
+size_t EncodeActuation(const Actuation& a, uint8_t* buf);
+bool DecodeActuation(const uint8_t* buf, size_t len, Actuation* a);
+
+size_t EncodePlanProblem(const PlanProblem& p, uint8_t* buf);
+bool DecodePlanProblem(const uint8_t* buf, size_t len, PlanProblem* p);
+
+size_t EncodePlanResult(const PlanResult& r, uint8_t* buf);
+bool DecodePlanResult(const uint8_t* buf, size_t len, PlanResult* r);
+
+// Size of the plan result frame starting in buf, read from its first
+// kPlanResultHeadSize bytes, or 0 if len does not cover those yet. For
+// reading result frames off a stream.
+size_t PlanResultSize(const uint8_t* buf, size_t len);
+
+const size_t kSequenceSize = 8;
+
+size_t EncodeSequence(uint64_t seq, uint8_t* buf);
+bool DecodeSequence(const uint8_t* buf, size_t len, uint64_t* seq);
+
+}  // namespace wire
+
+#endif /* WIRE_H */
@@ -0,0 +1,110 @@
+#ifndef WORKER_THREAD_H
+#define WORKER_THREAD_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs jobs on a thread of its own and hands them back once done. Jobs of a
+// higher priority (a lower number) go first, those of the same priority in
+// the order they were submitted. The submitting thread never waits for a
+// job; it is told about finished ones through a notify callback and
+// collects them when it gets to it.
+template <typename Job>
+class WorkerThread {
+ public:
+  // work runs every job on the worker thread. notify is called there after
+  // each job, e.g. to wake up the event loop that collects them. Jobs are
+  // submitted with priorities from 0 (highest) to priorities - 1.
+  WorkerThread(std::function<void(Job*)> work, std::function<void()> notify,
+               int priorities = 1)
+      : work_(work), notify_(notify), queues_(priorities), queued_(0),
+        stop_(false), thread_(&WorkerThread::Run, this) {}
+
+  // Finishes the running job, drops the ones still queued.
+  ~WorkerThread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_one();
+    thread_.join();
+  }
+
+  void Submit(Job* job, int priority = 0) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queues_[priority].push_back(job);
+      queued_++;
+    }
+    ready_.notify_one();
+  }
+
+  // Put job in the place of old if old has not been started yet. Returns
+  // false if it has; job is then not submitted.
+  bool Replace(Job* old, Job* job) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::deque<Job*>& queue : queues_) {
+      for (Job*& queued : queue) {
+        if (queued == old) {
+          queued = job;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Jobs submitted and not started yet
+  size_t queued() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+  }
+
+  // Append the jobs finished since the last call to done.
+  void Collect(std::vector<Job*>* done) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done->insert(done->end(), done_.begin(), done_.end());
+    done_.clear();
+  }
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      ready_.wait(lock, [this] { return stop_ || queued_ > 0; });
+      if (stop_) return;
+      std::deque<Job*>* queue = &queues_[0];
+      while (queue->empty()) ++queue;
+      Job* job = queue->front();
+      queue->pop_front();
+      queued_--;
+      lock.unlock();
+      work_(job);
+      lock.lock();
+      done_.push_back(job);
+      lock.unlock();
+      notify_();
+      lock.lock();
+    }
+  }
+
+  std::function<void(Job*)> work_;
+  std::function<void()> notify_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  // Queued jobs by priority
+  std::vector<std::deque<Job*>> queues_;
+  size_t queued_;
+  std::vector<Job*> done_;
+  bool stop_;
+  std::thread thread_;
+
+  WorkerThread(const WorkerThread&) = delete;
+  WorkerThread& operator=(const WorkerThread&) = delete;
+};
+
+#endif /* WORKER_THREAD_H */
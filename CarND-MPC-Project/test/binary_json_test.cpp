@@ -0,0 +1,194 @@
+// Checks the MessagePack and CBOR decoders of json.hpp: values round-trip
+// through the buffer and vector entry points and the SAX visitor, and
+// truncated or corrupted input throws instead of reading past the buffer.
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+static int failures = 0;
+
+static void Expect(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+// Counts the containers of a decode and checks that every string is inside
+// the input.
+struct Counter : json::binary_sax {
+  const uint8_t* begin;
+  const uint8_t* end;
+  int containers = 0;
+  int ends = 0;
+  bool inside = true;
+
+  Counter(const std::vector<uint8_t>& v)
+      : begin(v.data()), end(v.data() + v.size()) {}
+
+  void Text(const char* s, size_t len) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(s);
+    if (len > 0 && (p < begin || p + len > end)) inside = false;
+  }
+  void string(const char* s, size_t len) { Text(s, len); }
+  void key(const char* s, size_t len) { Text(s, len); }
+  void start_object(size_t) { containers++; }
+  void start_array(size_t) { containers++; }
+  void end_object() { ends++; }
+  void end_array() { ends++; }
+};
+
+// Values covering every length and width class of both formats.
+static std::vector<json> Values() {
+  std::vector<json> values = {
+      nullptr, true, false, 0, 23, 24, 255, 256, 65535, 65536, 4294967295u,
+      4294967296u, -1, -24, -25, -32, -33, -128, -129, -32768, -32769,
+      -2147483648ll, -2147483649ll, 0.5, -107.7717, 1e300,
+      json::array(), json::object(),
+  };
+  for (size_t len : {0, 23, 24, 31, 32, 255, 256, 65535, 65536}) {
+    values.push_back(std::string(len, 'a' + len % 26));
+    values.push_back(json::array());
+    for (size_t i = 0; i < std::min<size_t>(len, 300); ++i) {
+      values.back().push_back(i);
+    }
+  }
+  json object = json::object();
+  for (int i = 0; i < 20; ++i) object["key" + std::to_string(i)] = i * 0.5;
+  values.push_back(object);
+  values.push_back(json::parse(
+      "{\"ptsx\":[-32.16173,-43.49173,-61.09,-78.29172,-93.05002,-107.7717],"
+      "\"ptsy\":[113.361,105.941,92.88499,78.73102,65.34102,50.57938],"
+      "\"psi\":3.733651,\"x\":-40.62,\"y\":108.73,\"steering_angle\":0,"
+      "\"throttle\":0,\"speed\":0.4380091,\"nested\":[{\"a\":[[],{}]}]}"));
+  return values;
+}
+
+// Decodes v both ways and with the visitor, and checks the result.
+template <class Decode, class DecodeVector, class Sax>
+static void RoundTrip(const char* format, const json& value,
+                      const std::vector<uint8_t>& v, Decode decode,
+                      DecodeVector decode_vector, Sax sax) {
+  const std::string what =
+      std::string(format) + " " + value.dump().substr(0, 40);
+  Expect(decode(v.data(), v.size()) == value, what + " round-trips");
+  Expect(decode_vector(v) == value, what + " round-trips from a vector");
+  Counter counter(v);
+  Expect(sax(v.data(), v.size(), counter) == v.size(),
+         what + " is consumed whole");
+  Expect(counter.containers == counter.ends && counter.inside,
+         what + " reports balanced containers and strings in the input");
+
+  // Every shorter prefix ends inside the value
+  for (size_t len = 0; len < v.size(); len += 1 + len / 64) {
+    bool threw = false;
+    try {
+      decode(v.data(), len);
+    } catch (const std::out_of_range&) {
+      threw = true;
+    } catch (const std::exception&) {
+    }
+    Expect(threw, what + " truncated throws std::out_of_range");
+  }
+}
+
+// Flips bytes of v at random: the decoder may accept the result or throw,
+// but must not read outside the buffer. The input is copied to a buffer of
+// exactly its size, so a sanitizer catches any read past it.
+template <class Decode>
+static void Corrupt(const std::vector<uint8_t>& v, std::mt19937* random,
+                    Decode decode) {
+  for (int i = 0; i < 100; ++i) {
+    std::unique_ptr<uint8_t[]> corrupted(new uint8_t[v.size()]);
+    std::copy(v.begin(), v.end(), corrupted.get());
+    for (int flips = 1 + (*random)() % 3; flips > 0; --flips) {
+      corrupted[(*random)() % v.size()] ^= uint8_t(1 + (*random)() % 255);
+    }
+    try {
+      decode(corrupted.get(), v.size());
+    } catch (const std::exception&) {
+    }
+  }
+}
+
+// Whether decoding v throws E.
+template <class E, class Decode>
+static bool Throws(const std::vector<uint8_t>& v, Decode decode) {
+  try {
+    decode(v.data(), v.size());
+  } catch (const E&) {
+    return true;
+  } catch (const std::exception&) {
+  }
+  return false;
+}
+
+int main() {
+  const auto from_msgpack = [](const uint8_t* data, size_t size) {
+    return json::from_msgpack(data, size);
+  };
+  const auto from_cbor = [](const uint8_t* data, size_t size) {
+    return json::from_cbor(data, size);
+  };
+
+  std::mt19937 random(42);
+  for (const json& value : Values()) {
+    const std::vector<uint8_t> msgpack = json::to_msgpack(value);
+    RoundTrip("msgpack", value, msgpack, from_msgpack,
+              [](const std::vector<uint8_t>& v) {
+                return json::from_msgpack(v);
+              },
+              [](const uint8_t* data, size_t size, Counter& counter) {
+                return json::sax_parse_msgpack(data, size, counter);
+              });
+    Corrupt(msgpack, &random, from_msgpack);
+
+    const std::vector<uint8_t> cbor = json::to_cbor(value);
+    RoundTrip("cbor", value, cbor, from_cbor,
+              [](const std::vector<uint8_t>& v) { return json::from_cbor(v); },
+              [](const uint8_t* data, size_t size, Counter& counter) {
+                return json::sax_parse_cbor(data, size, counter);
+              });
+    Corrupt(cbor, &random, from_cbor);
+  }
+
+  // Indefinite-length CBOR items, which to_cbor does not write: a string
+  // in two chunks, an array and a map
+  const std::vector<uint8_t> indefinite = {
+      0xbf, 0x61, 'k', 0x7f, 0x61, 'a', 0x62, 'b', 'c', 0xff,
+      0x61, 'l', 0x9f, 0x01, 0x02, 0xff, 0xff};
+  Expect(json::from_cbor(indefinite) ==
+             json::parse("{\"k\":\"abc\",\"l\":[1,2]}"),
+         "indefinite-length CBOR decodes");
+  for (size_t len = 0; len < indefinite.size(); ++len) {
+    Expect(Throws<std::out_of_range>(
+               std::vector<uint8_t>(indefinite.begin(),
+                                    indefinite.begin() + len),
+               from_cbor),
+           "truncated indefinite-length CBOR throws std::out_of_range");
+  }
+
+  // Map keys that are not strings
+  Expect(Throws<std::domain_error>({0x81, 0x01, 0x02}, from_msgpack),
+         "msgpack integer key throws std::domain_error");
+  Expect(Throws<std::domain_error>({0xa1, 0x01, 0x02}, from_cbor),
+         "CBOR integer key throws std::domain_error");
+  Expect(Throws<std::domain_error>({0x7f, 0x01, 0xff}, from_cbor),
+         "CBOR string chunk of another type throws std::domain_error");
+  // A reserved initial byte
+  Expect(Throws<std::invalid_argument>({0xc1}, from_msgpack),
+         "msgpack 0xc1 throws std::invalid_argument");
+  Expect(Throws<std::invalid_argument>({0x1c}, from_cbor),
+         "CBOR reserved argument throws std::invalid_argument");
+
+  std::cout << (failures == 0 ? "passed" : "failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+// Checks that json.hpp parses numbers exactly as strtod does: every token
+// of a corpus of boundary, subnormal, long-mantissa and random doubles must
+// come out bit-identical, whether the lexer's fast path or its strtod
+// fallback converts it.
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+using json = nlohmann::basic_json<nlohmann::flat_map>;
+
+// Tokens at the edges of the fast path and of the double range
+const char* const kEdgeCases[] = {
+    // Exactly representable powers of ten and just beyond
+    "1e22", "1e23", "1e-22", "1e-23", "9e22", "10e22", "123456789e15",
+    // Significands at and beyond 2^53 and 19 digits
+    "9007199254740991", "9007199254740992", "9007199254740993",
+    "9007199254740993.0", "9007199254740991e5", "1234567890123456789",
+    "12345678901234567890", "1234567890123456789e-5",
+    "0.1234567890123456789", "0.12345678901234567891",
+    // Long mantissas that need every digit to round correctly
+    "2.22507385850720138309023271733240406421921598046233183055332741688720"
+    "4434813918195854283159012511020564067339731035811005152434161553460108"
+    "856012385377718821130777993532002330479610147442583636071921565046942"
+    "503734208375250806650616658158948720491179968591639648500635908770118"
+    "304874799780887753749949451580451605050915399856582470818645113537935"
+    "804992115981085766051992433352114352390148795699609591288891602992641"
+    "511063466313393663477586513029371762047325631781485664350872122828637"
+    "642044846811407613911477062801689853244110024161447421618567166150540"
+    "154285084716752901903161322778896729707373123334086988983175067838846"
+    "926092773977972858659654941091369095406136467568702398678315290680984"
+    "617210924625396728515625e-308",
+    "0.500000000000000166533453693773481063544750213623046875",
+    "3.518437208883201171875e13", "62.5364939768271845828",
+    "8.10109172351e-10", "1.00000005960464477550",
+    "7.3177701707893310e15", "2.2250738585072011e-308",
+    "9007199254740993.0000000000000000000000000001",
+    // Boundaries of the double range and subnormals
+    "1.7976931348623157e308", "1.7976931348623158e308",
+    "2.2250738585072014e-308", "2.2250738585072009e-308",
+    "4.9406564584124654e-324", "5e-324",
+    "2.4703282292062328e-324", "2.4703282292062327e-324", "1e-320",
+    "3.0e-310", "1.5e-315", "-4.9406564584124654e-324",
+    // Signs, zeros and plain decimals
+    "0.0", "-0.0", "0e10", "0.000", "1.0", "-1.5", "3.733651", "-107.7717",
+    "0.4380091", "1E5", "1e+5", "1.5E-3", "-2.5e-0",
+};
+
+// Whether json.hpp reads token as the double strtod reads. Tokens without
+// a fraction or exponent are integers to json.hpp, which has no -0.
+static bool Matches(const std::string& token, std::string* parsed) {
+  const double expected = std::strtod(token.c_str(), nullptr);
+  const json value = json::parse(token);
+  const double actual = value.get<double>();
+  if (value.is_number_float()
+          ? std::memcmp(&expected, &actual, sizeof(double)) == 0
+          : expected == actual) {
+    return true;
+  }
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), "%.17g, strtod %.17g", actual,
+                expected);
+  *parsed = buffer;
+  return false;
+}
+
+// n random decimal digits, the first of them not 0.
+static std::string Digits(std::mt19937_64* random, int n) {
+  std::string digits(1, char('1' + (*random)() % 9));
+  while (int(digits.size()) < n) digits += char('0' + (*random)() % 10);
+  return digits;
+}
+
+int main() {
+  std::vector<std::string> corpus(std::begin(kEdgeCases),
+                                  std::end(kEdgeCases));
+
+  std::mt19937_64 random(42);
+  char buffer[64];
+  for (int i = 0; i < 200000; ++i) {
+    // Any finite double, printed so that it round-trips
+    uint64_t bits = random();
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    if (std::isfinite(d)) {
+      std::snprintf(buffer, sizeof(buffer), "%.17g", d);
+      corpus.push_back(buffer);
+    }
+    // Short decimals such as the simulator sends
+    std::uniform_real_distribution<double> coordinate(-500, 500);
+    std::snprintf(buffer, sizeof(buffer), "%.*f", int(random() % 8),
+                  coordinate(random));
+    corpus.push_back(buffer);
+    // Long mantissas with exponents, around the fast path's limits of 19
+    // digits and 10^22
+    const std::string digits = Digits(&random, 1 + random() % 24);
+    std::snprintf(buffer, sizeof(buffer), "e%d", int(random() % 80) - 40);
+    corpus.push_back(digits + buffer);
+    // Near and in the subnormal range
+    std::snprintf(buffer, sizeof(buffer), "e-%d", 300 + int(random() % 24));
+    corpus.push_back(Digits(&random, 1) + "." +
+                     Digits(&random, 1 + random() % 20) + buffer);
+  }
+
+  int failures = 0;
+  for (const std::string& token : corpus) {
+    std::string parsed;
+    if (!Matches(token, &parsed)) {
+      if (++failures <= 10) {
+        std::cerr << token << " parsed as " << parsed << std::endl;
+      }
+    }
+  }
+  std::cout << corpus.size() << " numbers, " << failures << " mismatches"
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
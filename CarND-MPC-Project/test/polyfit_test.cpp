@@ -0,0 +1,67 @@
+// Checks the fixed-size polynomial fit: a cubic through exact samples comes
+// back as its coefficients, the prefactored fit matches the plain one over
+// the same samples, and Horner's rule evaluates the fit and its slope.
+#include <cmath>
+#include <iostream>
+#include <random>
+#include "polyfit.h"
+
+typedef PolyFit<3, 16> Fit;
+
+static int failures = 0;
+
+static void Expect(bool ok, const char* what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+int main() {
+  Fit::Coeffs cubic;
+  cubic << 0.5, 0.1, -0.01, 0.0005;
+
+  // Exact samples of the cubic, spaced like waypoints ahead of the car
+  double x[16];
+  double y[16];
+  for (int i = 0; i < 16; ++i) {
+    x[i] = 8.0 * i - 20.0;
+    y[i] = polyeval(cubic, x[i]);
+  }
+  Fit fit;
+  for (int n = 4; n <= 16; ++n) {
+    const Fit::Coeffs coeffs = fit.Fit(x, y, n);
+    Expect((coeffs - cubic).cwiseAbs().maxCoeff() < 1e-9,
+           "fit through exact samples recovers the cubic");
+  }
+
+  // Noisy samples: least squares through the prefactored projector
+  std::mt19937 random(42);
+  std::normal_distribution<double> noise(0.0, 0.5);
+  double noisy[16];
+  for (int i = 0; i < 16; ++i) noisy[i] = y[i] + noise(random);
+  for (int n = 4; n <= 16; ++n) {
+    Fit prefactored;
+    prefactored.Prefactor(x, n);
+    const Fit::Coeffs expected = fit.Fit(x, noisy, n);
+    const Fit::Coeffs actual = prefactored.FitPrefactored(noisy);
+    Expect((actual - expected).cwiseAbs().maxCoeff() < 1e-9,
+           "prefactored fit matches the plain fit");
+  }
+
+  // Horner's rule against the powers
+  for (double t = -30; t <= 100; t += 0.5) {
+    const double value = cubic[0] + cubic[1] * t + cubic[2] * t * t +
+                         cubic[3] * t * t * t;
+    const double slope = cubic[1] + 2 * cubic[2] * t + 3 * cubic[3] * t * t;
+    Expect(std::fabs(polyeval(cubic, t) - value) <=
+               1e-12 * (1 + std::fabs(value)),
+           "polyeval evaluates the cubic");
+    Expect(std::fabs(polyderiv(cubic, t) - slope) <=
+               1e-12 * (1 + std::fabs(slope)),
+           "polyderiv evaluates its slope");
+  }
+
+  std::cout << (failures == 0 ? "passed" : "failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
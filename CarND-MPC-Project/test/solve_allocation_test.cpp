@@ -0,0 +1,62 @@
+// Checks that a warm solve into a workspace allocates nothing of its own:
+// once the workspace has solved over a horizon, solving again over it or a
+// shorter one, switching between the CPU time limits of the controller's
+// own and speculative solves, leaves every heap allocation to the solver.
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "MPC.h"
+
+// Heap allocations outside the solver's own work
+static std::atomic<long> allocations(0);
+static thread_local bool in_solver = false;
+
+void* operator new(size_t size) {
+  if (!in_solver) allocations++;
+  if (void* p = std::malloc(size > 0 ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+static void SolverHook(bool entering) { in_solver = entering; }
+
+int main() {
+  MPCState state;
+  state << 0, 0, 0, 40, 0.5, 0.05;
+  MPCCoeffs coeffs;
+  coeffs << 0.5, 0.1, -0.01, 0.0005;
+  const double budgets[] = {0.5, 0.1};
+  const size_t horizons[] = {15, 10};
+
+  int failures = 0;
+  for (int checkpoint = 0; checkpoint < 2; ++checkpoint) {
+    MPC mpc;
+    mpc.set_checkpoint(checkpoint != 0);
+    mpc.set_solver_hook(SolverHook);
+    MPCWorkspace workspace;
+    SolveResult result;
+    // The first solve with each limit sizes the workspace
+    for (double budget : budgets) {
+      mpc.set_max_cpu_time(budget);
+      mpc.Solve(state, coeffs, &workspace, &result, horizons[0]);
+    }
+
+    const long before = allocations;
+    for (int i = 0; i < 20; ++i) {
+      mpc.set_max_cpu_time(budgets[i % 2]);
+      workspace.WarmStart();
+      mpc.Solve(state, coeffs, &workspace, &result, horizons[i / 10]);
+    }
+    const long allocated = allocations - before;
+    if (allocated != 0) {
+      std::cerr << "FAILED: warm solves"
+                << (checkpoint ? " with checkpoint" : "") << " allocated "
+                << allocated << " times" << std::endl;
+      failures++;
+    }
+  }
+  std::cout << (failures == 0 ? "passed" : "failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// Checks that the telemetry decoder of the binary wire format accepts only
+// frames the controller can act on: anything else arrives straight from
+// the network and must be dropped, not fitted.
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "wire.h"
+
+static int failures = 0;
+
+static void Expect(bool ok, const char* what) {
+  if (!ok) {
+    std::cerr << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+// A telemetry frame with n waypoints.
+static Telemetry MakeTelemetry(int n) {
+  Telemetry t = Telemetry();
+  t.x = 1;
+  t.y = 2;
+  t.psi = 0.5;
+  t.speed = 40;
+  t.n = n;
+  for (int i = 0; i < n; ++i) {
+    t.ptsx[i] = 10 * i;
+    t.ptsy[i] = i * i;
+  }
+  return t;
+}
+
+// A frame of kMaxWaypoints waypoints with its count changed to n, cut or
+// padded with zeros to the length that count implies. Returns the length.
+static size_t PatchCount(uint32_t n, uint8_t* buf) {
+  // The count comes right before the reserved word and the waypoints
+  const size_t points = wire::kHeaderSize + 6 * 8 + 8;
+  const size_t len =
+      wire::EncodeTelemetry(MakeTelemetry(Telemetry::kMaxWaypoints), buf);
+  for (int i = 0; i < 4; ++i) buf[points - 8 + i] = uint8_t(n >> (8 * i));
+  const size_t patched = points + 2 * 8 * n;
+  if (patched > len) std::memset(buf + len, 0, patched - len);
+  return patched;
+}
+
+int main() {
+  uint8_t buf[wire::kMaxFrameSize];
+  Telemetry decoded;
+
+  for (int n = Telemetry::kMinWaypoints; n <= Telemetry::kMaxWaypoints; ++n) {
+    const size_t len = wire::EncodeTelemetry(MakeTelemetry(n), buf);
+    Expect(wire::DecodeTelemetry(buf, len, &decoded) && decoded.n == n &&
+               decoded.ptsy[n - 1] == (n - 1) * (n - 1),
+           "frame with enough waypoints decodes");
+    Expect(!wire::DecodeTelemetry(buf, len - 1, &decoded),
+           "truncated frame is rejected");
+  }
+
+  // Too few waypoints to fit the reference path, down to none at all
+  for (int n = 0; n < Telemetry::kMinWaypoints; ++n) {
+    const size_t len = wire::EncodeTelemetry(MakeTelemetry(n), buf);
+    Expect(!wire::DecodeTelemetry(buf, len, &decoded),
+           "frame with too few waypoints is rejected");
+  }
+
+  // Counts out of range in frames of the length they claim, so that only
+  // the count check can reject them
+  uint8_t patched[wire::kMaxTelemetrySize + 2 * 8];
+  const uint32_t counts[] = {Telemetry::kMinWaypoints - 1,
+                             Telemetry::kMaxWaypoints + 1};
+  for (uint32_t n : counts) {
+    const size_t len = PatchCount(n, patched);
+    Expect(!wire::DecodeTelemetry(patched, len, &decoded),
+           n < uint32_t(Telemetry::kMinWaypoints)
+               ? "frame claiming too few waypoints is rejected"
+               : "frame claiming too many waypoints is rejected");
+  }
+  // The same frame with a count in range decodes, so the count alone is
+  // what rejects the others
+  const size_t len = PatchCount(Telemetry::kMinWaypoints, patched);
+  Expect(wire::DecodeTelemetry(patched, len, &decoded) &&
+             decoded.n == Telemetry::kMinWaypoints,
+         "patched frame with a valid count decodes");
+
+  std::cout << (failures == 0 ? "passed" : "failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}